@@ -0,0 +1,452 @@
+/*
+    ccp_pcm.c
+
+    Plays the clips of a WaveEdit -pcm or -adpcm sound bank through CCP1
+    as PWM: the carrier on RB3 comes from Timer2 alone, and the Timer2
+    postscaler interrupt loads the next sample into the duty cycle.  A
+    piezo (or a speaker through an RC low-pass and a transistor) on RB3
+    hears the duty as the sample level, 8 bits where cylon_sound.c has 1.
+    The bank holds 4 to 8 bit PCM, or 4-bit IMA ADPCM decoded here to
+    near 8-bit quality in half the ROM.
+
+    Timer2 at 1:1 with PR2 = 63 is a 64 cycle, 15625 Hz carrier with an
+    8-bit duty (256 quarter cycles), above what the piezo passes.  The
+    postscaler at 1:5 interrupts every 320 cycles, so samples play at
+    3125 Hz; the bank must be made for that rate:
+
+        WaveEdit -rate 3125 -adpcm -bank pcm.h hello.wav
+        WaveEdit -rate 3125 -pcm BITS -bank pcm.h hello.wav
+
+    At 4 bits that is 1.6 kbyte a second of sound, so this is built for
+    the 16F628 (2K words); the 16F627 holds about half a second.
+
+    For minutes of sound the clips go on a 25-series SPI flash instead
+    (a 4 Mbit part holds five and a half minutes of ADPCM):
+
+        WaveEdit -rate 3125 -adpcm -bank pcm.h -flash pcm.bin a.wav b.wav
+
+    pcm.bin is programmed into the flash from address 0 and pcm.h, now
+    only the index, defines SOUND_SPI.  The 16F62x has no SPI hardware,
+    so the master is bit-banged from main.  Either way main copies the
+    clip into a double buffer that the ISR reads from, so the ISR never
+    waits on the flash or reads the bank itself.
+
+    Wiring: piezo from RB3 to ground.  RB3 is an LED on the cylon boards,
+    so this is a demo on its own rather than part of them.  The flash,
+    if used: /CS on RB0, SCK on RB1, SI on RB2, SO on RB4, /WP and /HOLD
+    to Vdd.
+
+    Compile:    sdcc --debug -mpic14 -p16f628 ccp_pcm.c
+    Simulate:   gpsim -pp16f628 -s ccp_pcm.cod ccp_pcm.asm
+*/
+
+#include <pic16f628.h>
+
+/* Setup chip configuration */
+typedef unsigned int config;
+config at 0x2007 __CONFIG =
+	_CP_OFF &
+	_WDT_OFF &
+	_BODEN_OFF &
+	_PWRTE_OFF &
+	_INTRC_OSC_NOCLKOUT &
+	_MCLRE_ON &
+	_LVP_OFF;
+
+#include "pcm.h"		/* WaveEdit -rate 3125 -adpcm -bank pcm.h hello.wav */
+
+#if defined(SOUND_ADPCM)
+#define CODE_BITS	4
+#elif defined(SOUND_PCM)
+#define CODE_BITS	SOUND_PCM
+#else
+#error pcm.h is a 1-bit bank; make it with WaveEdit -pcm BITS or -adpcm
+#endif
+#ifdef SOUND_LZ
+#error ccp_pcm.c does not decode -lz banks
+#endif
+
+#define PCM_PR2		63		// 64 cycle period, 256 steps of duty
+#define PCM_T2CON	0x24	// postscale 1:5, Timer2 on, prescale 1:1: 3125 Hz
+#define PCM_SILENT	128		// duty of the mid level, between clips
+
+#ifdef SOUND_SPI
+unsigned long s_pos;		// flash address of the next byte of the clip
+unsigned long s_end;		// and where it stops
+#else
+unsigned int  s_pos;		// next byte of the clip in sound_bank[]
+unsigned int  s_end;		// and where it stops
+unsigned int  s_fetch;		// next byte main copies into s_buf[]
+#endif
+unsigned char s_on;			// a clip is playing
+unsigned char s_byte;		// the byte being played, next bit in bit 0
+unsigned char s_bits;		// bits left in s_byte
+unsigned char s_duty;		// sample for the next interrupt
+unsigned int  s_wait;		// interrupts left of a pause()
+unsigned char s_late;		// samples whose ISR ran into the next one
+
+#ifdef SOUND_ADPCM
+// IMA ADPCM step sizes, as ImaAdpcm.StepSizes in the quantiser
+const unsigned int ima_step[] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+#define IMA_LAST	88
+
+unsigned int  a_level;		// predictor + 0x8000, so the top byte is the duty
+unsigned int  a_step;		// ima_step[a_index], read once per sample and
+							// shifted down by the decode
+unsigned int  a_diff;
+unsigned char a_index;
+#endif
+
+/*
+    Double buffer.  The ISR reads s_buf[s_rd] round both halves; as it
+    moves into one half it sets s_fill, and main refills the half it
+    left (s_half) with 16 more bytes, clocked out of the flash, whose
+    READ command stays open for the whole clip, or read from
+    sound_bank[].  At 4-bit ADPCM a half lasts 10mS and a refill takes
+    under 1mS.
+*/
+#define BUF_HALF	16
+unsigned char s_buf[2 * BUF_HALF];
+unsigned char s_rd;			// next byte the ISR takes, 0..31
+unsigned char s_half;		// 0 or BUF_HALF, the half to refill
+unsigned char s_fill;		// set by the ISR, cleared by main
+
+// One byte of the clip into the ISR player, from the buffer.
+#define SOUND_BYTE(v) \
+	v = s_buf[s_rd]; \
+	s_pos++; \
+	s_rd = (s_rd + 1) & (2 * BUF_HALF - 1); \
+	if ((s_rd & (BUF_HALF - 1)) == 0) \
+	{ \
+		s_half = s_rd ^ BUF_HALF; \
+		s_fill = 1; \
+	}
+
+static void isr(void) interrupt 0 {
+
+	unsigned char i;
+
+	/*
+	Timer2 postscaler, 3125 Hz.  The sample decoded last time is written
+	first, so every duty change lands the same number of cycles into the
+	interrupt; the PWM latches it at the start of the next period.
+
+	Worst case at 4MHz, 320 cycles per sample, estimated by hand from the
+	PIC instructions these statements need (neither counted from sdcc
+	output nor timed with the gpsim stopwatch, so treat them as rough):
+	context save/restore ~25, duty ~10, s_wait ~8, end test ~10, one
+	s_buf[] byte with its count and half check ~25 and the bits ~15 for
+	4 or 8 bit banks, ~15 a bit for 5 to 7; so ~95 (30%), or ~185 (58%)
+	at 7 bits.  From SPI flash the end test and count are 32-bit, ~15
+	more.  The bank itself is never read here, main refills s_buf[] in
+	sound_feed(), so the only code pointer read left is ADPCM's
+	ima_step[]; ADPCM is the 4-bit path with its nibble replaced by the
+	~155 cycle step below, ~235 (73%) on a sample that takes a byte.
+	
+	s_late counts samples that overran, still in here when the next
+	interrupt was due.  Play every clip in gpsim or on the board and
+	check it stays 0 after changing this routine.
+	*/
+	TMR2IF = 0;
+	CCPR1L = s_duty >> 2;
+	CCP1CON = 0x0C | ((s_duty & 3) << 4);	// PWM, DC1B = low 2 bits
+
+	if (s_wait != 0)
+		s_wait--;
+
+	if (!s_on)
+		return;
+	if (s_bits < CODE_BITS && s_pos == s_end)
+	{
+		s_duty = PCM_SILENT;
+		s_on = 0; //finished
+		return;
+	}
+
+	/*
+	Codes are packed LSB first.  Shifting each bit in from the top of
+	s_duty leaves the code left-justified as the 8-bit duty, the level
+	PcmPacker.Level() gives it.
+	*/
+#if defined(SOUND_ADPCM)
+	if (s_bits == 0)
+	{
+		SOUND_BYTE(s_byte);
+		s_bits = 8;
+	}
+	i = s_byte & 15;
+	s_byte >>= 4;
+	s_bits -= 4;
+
+	/*
+	IMA ADPCM with shifts and adds, no multiply: the difference is
+	step/8 plus step, step/2 and step/4 for code bits 2, 1 and 0, and
+	bit 3 is its sign.  a_step is shifted down one place at a time, as
+	it is read again at the end.  The predictor is kept offset by
+	0x8000, so its clamps to -32768..32767 are the unsigned carry and
+	borrow.
+	
+	Worst case, counted by hand in PIC instructions with a bank select
+	per statement (not from sdcc's .asm, which was not to hand): code 7
+	or 15, every add taken, and the index +8 and clamped at IMA_LAST.
+	Nibble ~10; difference: three 16-bit shifts ~9, four adds and their
+	tests ~30; the add with its carry clamp ~19, or the compare and
+	subtract ~16; duty ~4; index add and clamp ~15; the 16-bit ima_step[]
+	read, its offset, pointer and two code reads in the helper, ~55.
+	With the 2-cycle jumps over untaken branches, ~155 cycles.
+	*/
+	a_diff = 0;
+	if (i & 4)
+		a_diff = a_step;
+	a_step >>= 1;
+	if (i & 2)
+		a_diff += a_step;
+	a_step >>= 1;
+	if (i & 1)
+		a_diff += a_step;
+	a_step >>= 1;
+	a_diff += a_step;				// step/8
+	if (i & 8)
+	{
+		if (a_diff > a_level)
+			a_level = 0;
+		else
+			a_level -= a_diff;
+	}
+	else
+	{
+		a_level += a_diff;
+		if (a_level < a_diff)
+			a_level = 0xFFFF;		// carried out of 16 bits
+	}
+	s_duty = a_level >> 8;
+
+	// Step index -1 for codes 0..3, +2, +4, +6, +8 for 4..7.
+	if (i & 4)
+		a_index += ((i & 3) << 1) + 2;
+	else if (a_index != 0)
+		a_index--;
+	if (a_index > IMA_LAST)
+		a_index = IMA_LAST;
+	a_step = ima_step[a_index];
+#elif CODE_BITS == 8
+	SOUND_BYTE(s_duty);
+#elif CODE_BITS == 4
+	if (s_bits == 0)
+	{
+		SOUND_BYTE(s_byte);
+		s_bits = 8;
+	}
+	s_duty = s_byte << 4;
+	s_byte >>= 4;
+	s_bits -= 4;
+#else
+	s_duty = 0;
+	for (i = CODE_BITS; i != 0; i--)
+	{
+		if (s_bits == 0)
+		{
+			SOUND_BYTE(s_byte);
+			s_bits = 8;
+		}
+		s_duty >>= 1;
+		if (s_byte & 1)
+			s_duty |= 0x80;
+		s_byte >>= 1;
+		s_bits--;
+	}
+#endif
+
+	if (TMR2IF)
+		s_late++;
+}
+
+#ifdef SOUND_SPI
+/*
+    Bit-banged SPI master, mode 0 (SCK idles low, both sides sample on
+    the rising edge), MSB first, for any 25-series flash or EEPROM with
+    the 0x03 READ command.  The shifts are unrolled: a bit out is bcf,
+    btfsc, bsf, bsf, bcf, 5 cycles, and a bit in bsf, btfsc, bsf, bcf,
+    4 cycles, so a byte in is ~40 cycles with the call (25 kbyte/S at
+    4MHz) and SCK is high for 2uS, slow enough for any part.
+*/
+#define FLASH_CS	RB0		// chip select, active low
+#define FLASH_SCK	RB1
+#define FLASH_SI	RB2		// data to the flash
+#define FLASH_SO	RB4		// data from the flash, an input
+#define FLASH_READ	0x03
+#define FLASH_WAKE	0xAB	// release from deep power-down
+#define FLASH_ADDR_BYTES	3	// 2 for 25LC EEPROMs of 512 Kbit and under
+
+unsigned char spi_v;
+
+#define SPI_OUT(b) \
+	FLASH_SI = 0; \
+	if (spi_v & (b)) FLASH_SI = 1; \
+	FLASH_SCK = 1; \
+	FLASH_SCK = 0
+#define SPI_IN(b) \
+	FLASH_SCK = 1; \
+	if (FLASH_SO) spi_v |= (b); \
+	FLASH_SCK = 0
+
+static void spi_out(unsigned char v)
+{
+	spi_v = v;
+	SPI_OUT(0x80); SPI_OUT(0x40); SPI_OUT(0x20); SPI_OUT(0x10);
+	SPI_OUT(0x08); SPI_OUT(0x04); SPI_OUT(0x02); SPI_OUT(0x01);
+}
+
+static unsigned char spi_in(void)
+{
+	spi_v = 0;
+	SPI_IN(0x80); SPI_IN(0x40); SPI_IN(0x20); SPI_IN(0x10);
+	SPI_IN(0x08); SPI_IN(0x04); SPI_IN(0x02); SPI_IN(0x01);
+	return spi_v;
+}
+
+// Ends any read and starts a new one at addr; bytes follow on spi_in()
+// for as long as /CS stays low.
+static void flash_open(unsigned long addr)
+{
+	FLASH_CS = 1;
+	FLASH_CS = 0;
+	spi_out(FLASH_READ);
+#if FLASH_ADDR_BYTES == 3
+	spi_out(addr >> 16);
+#endif
+	spi_out(addr >> 8);
+	spi_out(addr);
+}
+
+// n bytes of the open read into s_buf[to..].
+static void flash_in(unsigned char to, unsigned char n)
+{
+	do {
+		s_buf[to++] = spi_in();
+	} while (--n);
+}
+#else
+// n bytes of the clip into s_buf[to..]; none past its end, as a read
+// off the end of sound_bank[] would land in whatever code follows it.
+static void bank_in(unsigned char to, unsigned char n)
+{
+	do {
+		if (s_fetch != s_end)
+			s_buf[to] = sound_bank[s_fetch++];
+		to++;
+	} while (--n);
+}
+#endif
+
+// Starts clip sound_id of the bank; s_on is set last so the ISR sees a
+// whole start.  Both buffer halves are filled first.
+void play_sound(unsigned char sound_id)
+{
+	s_on = 0;
+	s_pos = sound_index[sound_id*2];
+	s_end = s_pos + sound_index[sound_id*2+1];
+	s_bits = 0;
+	s_rd = 0;
+	s_fill = 0;
+#ifdef SOUND_SPI
+	flash_open(s_pos);
+	flash_in(0, 2 * BUF_HALF);
+#else
+	s_fetch = s_pos;
+	bank_in(0, 2 * BUF_HALF);
+#endif
+#ifdef SOUND_ADPCM
+	a_level = 0x8000;		// predictor 0, the mid level
+	a_index = 0;
+	a_step = ima_step[0];
+#endif
+	s_on = 1;
+}
+
+// Keeps a playing clip fed; call it from main while s_on is set, at
+// least once a half (16 bytes of samples).
+void sound_feed(void)
+{
+	if (s_fill)
+	{
+		s_fill = 0;
+#ifdef SOUND_SPI
+		flash_in(s_half, BUF_HALF);
+#else
+		bank_in(s_half, BUF_HALF);
+#endif
+	}
+#ifdef SOUND_SPI
+	if (!s_on)
+		FLASH_CS = 1;		// end the read, the flash can go to standby
+#endif
+}
+
+// Waits n sample periods (320uS).  s_wait is read with the interrupt
+// off, as the ISR could change it between its two bytes.
+void pause(unsigned int n)
+{
+	unsigned int left;
+
+	TMR2IE = 0;
+	s_wait = n;
+	TMR2IE = 1;
+	do {
+		TMR2IE = 0;
+		left = s_wait;
+		TMR2IE = 1;
+	} while (left != 0);
+}
+
+void main(void) {
+
+	unsigned char id;
+
+	CMCON = 0x07;           /* disable comparators */
+	TRISB = 0x10;           /* RB3 is the CCP1 pin, RB4 the flash's SO */
+	PORTB = 0x01;           /* flash deselected */
+	TRISA = 0x04;           /* RA2 is the mode input on the cylon boards */
+
+	s_duty = PCM_SILENT;
+	s_on = 0;
+	s_late = 0;
+	PR2 = PCM_PR2;
+	CCPR1L = PCM_SILENT >> 2;
+	CCP1CON = 0x0C;         /* PWM; the carrier runs from now on */
+	TMR2 = 0;
+	T2CON = PCM_T2CON;
+
+	INTCON = 0;
+	TMR2IE = 1;
+	PEIE = 1;
+	GIE = 1;
+
+#ifdef SOUND_SPI
+	pause(1);				// flash power-up
+	FLASH_CS = 0;
+	spi_out(FLASH_WAKE);	// in case it was left in deep power-down
+	FLASH_CS = 1;
+	pause(1);
+#endif
+
+	while (1) {
+		for (id = 0; id < SOUND_COUNT; id++) {
+			play_sound(id);
+			while (s_on)
+				sound_feed();
+			sound_feed();
+			pause(3125);	// 1 S between clips
+		}
+	}
+}
@@ -0,0 +1,155 @@
+/*
+    ccp_tone.c
+
+    Plays the cylon tune[] on the piezo from the CCP1 hardware, with no
+    software toggling.  CCP1 runs as a 50% PWM, so the square wave on
+    RB3 comes from Timer2 alone and costs no cycles; Timer1 times each
+    note and its overflow is the only interrupt, one per note (or per
+    524 mS of a long one).
+
+    CCP1's compare-toggle mode does not reset Timer1 on a match, so a
+    steady tone from it would need an interrupt every half period to
+    move CCPR1; the PWM period register does that in hardware.
+
+    Wiring: piezo from RB3 to ground.  RB3 is an LED on the cylon boards,
+    so this is a demo on its own rather than part of them.
+
+    Compile:    sdcc --debug -mpic14 -p16f627 ccp_tone.c
+    Simulate:   gpsim -pp16f627 -s ccp_tone.cod ccp_tone.asm
+*/
+
+#include <pic16f627.h>
+
+/* Setup chip configuration */
+typedef unsigned int config;
+config at 0x2007 __CONFIG =
+	_CP_OFF &
+	_WDT_OFF &
+	_BODEN_OFF &
+	_PWRTE_OFF &
+	_INTRC_OSC_NOCLKOUT &
+	_MCLRE_ON &
+	_LVP_OFF;
+
+/*
+    Timer2 counts 1MHz/16 = 62500 Hz, so a note of f Hz is a PR2 of
+    round(62500 / f) - 1, within 10 cents of equal temperament.  A PR2
+    of 255 is 244 Hz, the lowest this clock reaches: A3 and A#3 are
+    played an octave up.  Same note numbers as note_inc[] in
+    cylon_basic2.c, 0 = silent.
+*/
+const unsigned char note_pr2[] = {
+	0,
+	141,133,252,238,224,212,200,189,178,168,158,149,	// A3 .. G#4
+	141,133,126,118,112,105, 99, 94, 88, 83, 79, 74,	// A4 .. G#5
+	 70													// A5
+	};
+
+// [length in 16 ticks (8.2ms), RA6 note, RA7 note], length 0 ends, as
+// cylon_basic2.c.  There is one CCP, so only the RA6 note is played.
+const unsigned char tune[] = {
+	12,15,0,	6,0,0,	18,8,0,	6,0,0,	36,8,15,	0			// B4, E4, E4+B4
+	};
+
+unsigned char t;			// 1 + index of the next chord, 0 stopped
+unsigned char t_left;		// lengths left of the current note
+
+#define T1_PER_LENGTH	1024	// Timer1 counts per length (8192 cycles) at 1:8
+#define T1_MAX_LENGTHS	64		// lengths in one Timer1 overflow
+
+// Starts the tone for note n, or silences the pin for 0.
+static void tone(unsigned char n)
+{
+	unsigned char p;
+
+	if (n == 0)
+	{
+		CCP1CON = 0;		// CCP off, RB3 back to PORTB
+		RB3 = 0;
+		return;
+	}
+	p = note_pr2[n];
+	TMR2 = 0;				// no long first period if TMR2 was past PR2
+	PR2 = p;
+	// 50% duty is 2*(PR2+1) in the 10-bit duty register
+	CCPR1L = (p >> 1) + (p & 1);
+	CCP1CON = (p & 1) ? 0x0C : 0x2C;	// PWM, DC1B1 = low bit of 2*(PR2+1)/4
+}
+
+// Loads Timer1 to overflow after up to T1_MAX_LENGTHS of t_left.
+static void note_wait(void)
+{
+	unsigned char n = (t_left > T1_MAX_LENGTHS) ? T1_MAX_LENGTHS : t_left;
+	unsigned int count = 0 - (unsigned int)n * T1_PER_LENGTH;
+
+	t_left -= n;
+	TMR1ON = 0;
+	TMR1H = count >> 8;
+	TMR1L = count;
+	TMR1ON = 1;
+}
+
+static void isr(void) interrupt 0 {
+
+	/*
+	Timer1 overflow, once per note: play the next chord's RA6 note for
+	its length.  Nothing runs between notes.
+	*/
+	TMR1IF = 0;
+	if (t == 0)
+		return;
+
+	if (t_left == 0)
+	{
+		t_left = tune[t-1];
+		if (t_left == 0)
+		{
+			tone(0);
+			TMR1ON = 0;
+			t = 0; //finished
+			return;
+		}
+		tone(tune[t]);
+		t += 3;
+	}
+	note_wait();
+}
+
+// Starts tune[] from the top.
+void tune_play(void)
+{
+	t = 1;
+	t_left = 0;
+	TMR1IF = 1;			// straight into the ISR for the first note
+}
+
+void main(void) {
+
+	CMCON = 0x07;           /* disable comparators */
+	TRISB = 0x00;           /* all outputs, RB3 is the CCP1 pin */
+	PORTB = 0;
+	TRISA = 0x04;           /* RA2 is the mode input on the cylon boards */
+
+	T2CON = 0x06;           /* Timer2 on, 1:16 prescale */
+	T1CON = 0x30;           /* Timer1 1:8 prescale, internal clock, off */
+
+	INTCON = 0;
+	TMR1IE = 1;
+	PEIE = 1;
+	GIE = 1;
+
+	while (1) {
+		tune_play();
+		while (t != 0)
+			;
+		TMR1IE = 0;		// one polled overflow, 524 mS between plays
+		TMR1H = 0;
+		TMR1L = 0;
+		TMR1IF = 0;
+		TMR1ON = 1;
+		while (!TMR1IF)
+			;
+		TMR1ON = 0;
+		TMR1IE = 1;
+	}
+}
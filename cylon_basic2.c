@@ -38,13 +38,88 @@ static unsigned char t0;
 	
 static unsigned char i; // array iterator
 
-static unsigned char  wlc;  //wave length in 0.5us i.e. 1Khz = 0.5us on, 0.5us off -> L=1ms => 1Khz
-static unsigned char  wln;  //wave length in 0.5us i.e. 1Khz = 0.5us on, 0.5us off -> L=1ms => 1Khz
+// RA0/RA1 LED bits of the frame on show.  The ISR writes PORTA every
+// tick, so it takes the LED bits from here rather than reading the port
+// back; only the sequencer sets it.
+unsigned char led_a;
 
+/*
+ Pattern ROM: each frame is the finished PORTA and PORTB image, side by
+ side, so the ISR shows one with two port writes and nothing to mask.
+ FRAME() takes the 10 LEDs as one number, left to right RA1 RA0 B7 .. B0
+ (0x200 is RA1 alone, 0x001 B0), and splits it at compile time; the ISR
+ adds RA6/RA7.  pattern_index[] is [offset, length] in bytes of each
+ pattern in pattern_rom[].
+*/
+#define FRAME(leds)	(((leds) >> 8) & 1) | (((leds) >> 8) & 2), (leds) & 0xFF
+
+#define PATTERN_SCAN		0	/* the eye, back and forth */
+#define PATTERN_WIPE_UP		1	/* the eye, left to right */
+#define PATTERN_WIPE_DOWN	2	/* and right to left */
+#define PATTERN_IDLE		3	/* waiting for a mode */
+#define PATTERN_BLINK		4	/* power on */
+
+const unsigned int pattern_index[] = {
+	0,32,
+	32,20,
+	52,20,
+	72,2,
+	74,4,
+};
+
+const unsigned char pattern_rom[] = {
+	// PATTERN_SCAN
+	FRAME(0x300), FRAME(0x180), FRAME(0x0C0), FRAME(0x070),
+	FRAME(0x038), FRAME(0x00C), FRAME(0x006), FRAME(0x003),
+	FRAME(0x001), FRAME(0x003), FRAME(0x006), FRAME(0x00C),
+	FRAME(0x038), FRAME(0x070), FRAME(0x0C0), FRAME(0x180),
+	// PATTERN_WIPE_UP
+	FRAME(0x200), FRAME(0x300), FRAME(0x180), FRAME(0x0C0),
+	FRAME(0x070), FRAME(0x038), FRAME(0x00C), FRAME(0x006),
+	FRAME(0x003), FRAME(0x001),
+	// PATTERN_WIPE_DOWN
+	FRAME(0x001), FRAME(0x003), FRAME(0x006), FRAME(0x00C),
+	FRAME(0x038), FRAME(0x070), FRAME(0x0C0), FRAME(0x180),
+	FRAME(0x300), FRAME(0x200),
+	// PATTERN_IDLE
+	FRAME(0x084),
+	// PATTERN_BLINK
+	FRAME(0x1CE), FRAME(0x14A),
+};
+
+// Pattern sequencer, stepped by the ISR.  seq_play() looks a pattern up
+// and the ISR shows its first frame on the next tick, then a frame every
+// q_ticks ticks, from the top again after the last.
+#define SEQ_NONE	0xFF			// no pattern, for cylon()
+unsigned char q_ticks;			// ticks per frame
+unsigned char q_wait;			// ticks to the next frame, 0 = stopped
+unsigned int  q_f;				// next frame, byte offset in pattern_rom[]
+unsigned int  q_start;			// first frame of the pattern
+unsigned int  q_end;			// and the offset after its last
+
+// DDS voices.  Each pin follows the top bit of a 16-bit phase that
+// advances by its increment every tick, so f = inc * 1953.125 / 65536 Hz
+// (0.03Hz steps) at the 4MHz, PS 000 tick.  The piezo across RA6/RA7
+// hears the difference of the two square waves, so two voices make a
+// chord.  Up to the 976Hz Nyquist limit any pitch is available; the
+// edges land on tick boundaries, so high notes are a little rough.
+unsigned int phase0, phase1;	// RA6, RA7
+unsigned int inc0, inc1;		// 0 holds the voice still
+unsigned char t_out;
+unsigned int t_left;			// ticks left of the current chord
+
+// Phase increments of equal tempered A3 (220Hz) .. A5 (880Hz), 0 = silent:
+// round(f * 65536 / 1953.125)
+const unsigned int note_inc[] = {
+	0,
+	7382, 7821, 8286, 8779, 9301, 9854,10440,11060,11718,12415,13153,13935,	// A3 .. G#4
+	14764,15642,16572,17557,18601,19708,20879,22121,23436,24830,26306,27871,	// A4 .. G#5
+	29528																	// A5
+	};
 
-// [t/10ms, f]
-static unsigned char tune[] = {
-	100,2,100,0,100,3,100,0,0
+// [length in 16 ticks (8.2ms), RA6 note, RA7 note], length 0 ends
+const unsigned char tune[] = {
+	12,15,0,	6,0,0,	18,8,0,	6,0,0,	36,8,15,	0			// B4, E4, E4+B4
 	};
 	
 
@@ -59,8 +134,6 @@ static void isr(void) interrupt 0 {
 
     T0IF = 0;               /* Clear timer interrupt flag */     
 	
-	PORTA ^= 0x80;  		//Flip Bit very -0.5ms = 1kHz
-	
 	if (Msec >0) Msec--;
 	
 	if ((PORTA & 0x04) != 0)   //RA2 (pin1)
@@ -78,49 +151,58 @@ static void isr(void) interrupt 0 {
 		
 	}
 		
-	if(t==1)
+	/*
+	Tone engine, every tick: both phases advance and RA6/RA7 are written
+	once, so it costs the same whatever the notes.  A new chord is read
+	every tune[t-1]*16 ticks.
+	
+	Worst case at 4MHz, 512 cycles per tick, estimated by hand from the
+	PIC instructions these statements need (neither counted from sdcc
+	output nor timed with the gpsim stopwatch, see isr.c, so treat them
+	as rough): context save/restore ~25, Msec and RA2 ~15,
+	phases and port ~21, chord count ~16, and on a chord boundary three
+	tune[] and two note_inc[] reads through the code pointer helpers
+	~200, so ~280 cycles (55%) once per chord and ~80 (16%) otherwise.
+	The sequencer adds ~8, or ~70 on a frame tick, ~350 (68%) at worst;
+	its frame goes out with this tick's RA6/RA7.  It never starts a
+	pattern here: seq_play() reads pattern_index[] in main, which keeps
+	the ~160 of those two code pointer reads off the tick.
+	*/
+	if (q_wait != 0 && --q_wait == 0)
 	{
-		wln=tune[t-1];
-		wlc=tune[t];
-		t+=2;
+		q_wait = q_ticks;
+		if (q_f == q_end)
+			q_f = q_start;
+		led_a = pattern_rom[q_f];		// into PORTA below
+		PORTB = pattern_rom[q_f + 1];
+		q_f += 2;
 	}
 	
+	phase0 += inc0;
+	phase1 += inc1;
+	t_out = led_a;
+	if (phase0 & 0x8000) t_out |= 0x40;
+	if (phase1 & 0x8000) t_out |= 0x80;
+	PORTA = t_out;
 	
-	if (t>0 ) //
+	if (t != 0)
 	{
-		if (wlc!=0)
+		if (t == 1 || --t_left == 0)
 		{
-			if (wlc >0) 
+			t_left = (unsigned int)tune[t-1] << 4;
+			if (t_left != 0)
 			{
-				wlc--;
-				if (wlc==0) 
-				{
-					// flip bit A6;
-					PORTA ^= 0X40; 
-					
-					wln--;
-					if (wln==0)
-					{
-						wln=tune[t-1];	
-						if (wln != 0) 
-						{
-							wlc=tune[t];
-							t+=2;
-						}
-						else
-						{
-							t=0; //finished
-						}
-					}
-					else
-						wlc=tune[t-2];
-				}
+				inc0 = note_inc[tune[t]];
+				inc1 = note_inc[tune[t+1]];
+				t += 3;
 			}
-		}
-		else
-		{
-			if (wln>0) {
-				wln--;
+			else
+			{
+				inc0 = 0;
+				inc1 = 0;
+				phase0 = 0;		// both pins low, no DC across the piezo
+				phase1 = 0;
+				t = 0; //finished
 			}
 		}
 	}
@@ -163,13 +245,22 @@ void init(void) {
     PS1 = 0;  
     PS0 = 0;  
 
+	// State the ISR reads, set before T0IE: sdcc does not clear RAM, and
+	// from the first tick on it steps the sequencer and the tune.
+	led_a = 0;
+	q_wait = 0;
+	t = 0;
+	inc0 = 0;
+	inc1 = 0;
+	phase0 = 0;
+	phase1 = 0;
+
     INTCON = 0;             /* clear interrupt flag bits */
     GIE = 1;                /* global interrupt enable */
     T0IE = 1;               /* TMR0 overflow interrupt enable */
       
         
     TMR0 = 0;               /* clear the value in TMR0 */
- 
 }
 
 
@@ -187,101 +278,73 @@ void delay(unsigned char ms)
 	
 	while (Msec) 
 	{
-		PORTA ^= 0x40;  		//Flip Bit
-	}  		//Flip Bit
+	}
+}
+
+// Stops the tune; the ISR leaves the voices alone once t is 0.
+void tune_stop(void)
+{
+	t = 0;
+	inc0 = 0;
+	inc1 = 0;
+	phase0 = 0;
+	phase1 = 0;
+}
+
+
+// Starts pattern id on the next tick, a frame every ticks ticks, in
+// place of whatever is showing.  The pattern_index[] reads are done
+// here rather than on a tick.
+void seq_play(unsigned char id, unsigned char ticks)
+{
+	unsigned int start = pattern_index[id << 1];
+	unsigned int end = start + pattern_index[(id << 1) + 1];
+	
+	T0IE = 0;
+	q_start = start;
+	q_end = end;
+	q_f = start;
+	q_ticks = ticks;
+	q_wait = 1;
+	T0IE = 1;
 }
 
 
 #define CYLON_SCAN_DELAY 20
-#define mask_a (unsigned char)0xFC
-#define mask_b (unsigned char)0x00
+#define CYLON_SCAN_TICKS (CYLON_SCAN_DELAY * 4)	// delay() counts 4 ticks per unit
+#define BLINK_TICKS 200
 
-/* 10 bits */
-const unsigned char cylon_bits_a[] = { 2,3,  1,  0,  0, 0, 0,0,0,0 };
-const unsigned char cylon_bits_b[] = { 0,0,128,192,112,56,12,6,3,1 };
+// Pattern shown for each Mode
+const unsigned char mode_pattern[] = {
+	PATTERN_IDLE, PATTERN_SCAN, PATTERN_WIPE_UP, PATTERN_WIPE_DOWN
+	};
 
 void cylon() {
 
+	unsigned char m = SEQ_NONE;	// Mode on show, none yet
 
+    tune_stop();
 	
-//	const unsigned char mask_a = 0xfc;
-//const unsigned char mask_b = 0x00;
-
-    t=0;
-	
-	 
+	seq_play(PATTERN_BLINK, BLINK_TICKS);
  	for (i=0; i<30; i++)
 	{
 		delay(50);
-		if (i%2==0) {
-			PORTA = 1;
-			PORTB = 206;  //00 10000100
-		}
-		else {
-			PORTA = 1;
-			PORTB = 74;  //00 10000100
-		}
 	}
-	
-
 
 	while(1) {
 	
-		
-		t=0;
-	
-		while (Mode==0) // wait until mode set
-		{
-			PORTA = 0;
-			PORTB = 132;  //00 10000100
-			delay(CYLON_SCAN_DELAY);		
-		}	
-		
-		t=1;
-	
-
-		if(Mode==1) {
-
-			// traditional (back & forth) cylon scanner
-
-			for(i = 1; i < sizeof(cylon_bits_a); i++) {
-			
+		// Nothing here blocks, so a button press (Mode, from the ISR) is
+		// seen at once and its pattern starts on the next tick.  Other
+		// work can go in this loop; Timer0 stops in SLEEP, so it cannot
+		// sleep between ticks.
+		if (m != Mode) {
+			m = Mode;
+			seq_play(mode_pattern[m], CYLON_SCAN_TICKS);
 			
-				PORTA &= mask_a;
-				PORTA |= cylon_bits_a[i];
-				PORTB &= mask_b;
-				PORTB |= cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
-
-			for(i = sizeof(cylon_bits_a) - 2; i > 1; i--) {
-				PORTA &= mask_a;
-				PORTA |= cylon_bits_a[i];
-				PORTB &= mask_b;
-				PORTB |= cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
-
-		} else if(Mode==2) {
-
-			// single direction scan
-
-			for(i = 0; i < sizeof(cylon_bits_a); i++) {
-				PORTA = cylon_bits_a[i];
-				PORTB = cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
-
-
-		} else if(Mode==3) {
-
-			// other direction scan
-
-			for(i = sizeof(cylon_bits_a); i > 0; i--) {
-				PORTA = cylon_bits_a[i];
-				PORTB = cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
+			if (m == 0)
+				tune_stop();
+			else
+				t = 1;		// the chord again for each new mode
 		}
 	}
 }
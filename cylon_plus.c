@@ -35,19 +35,340 @@ static unsigned int  Cnt;
 static unsigned char Mode;
 
 
-unsigned char s_mask;
-char *s_bytes, *s_bytes_;
 unsigned char c_byte;
 unsigned char t_byte;
 
-unsigned char  wlc;  //wave length in 0.5us i.e. 1Khz = 0.5us on, 0.5us off -> L=1ms => 1Khz
-unsigned char  wln;  //wave length in 0.5us i.e. 1Khz = 0.5us on, 0.5us off -> L=1ms => 1Khz
-
+// RA0/RA1 LED bits of the bit-plane on show.  The ISR writes PORTA every
+// tick, so it takes the LED bits from here rather than reading the port
+// back; only the BAM step sets it.
+unsigned char led_a;
+
+// Sound effects, one bit per tick LSB first as WaveEdit packs them, in
+// the sounds.h layout: a WaveEdit -bank header made without -lz can
+// take the place of these.
+#define SOUND_BUZZ	0	/* 976Hz, the tick rate / 2 */
+#define SOUND_HUM	1	/* 488Hz */
+#define SOUND_COUNT	2
+
+// [offset, length] in bytes of each clip in sound_bank[]
+const unsigned int sound_index[] = {
+	0,3,
+	3,3,
+};
+
+const unsigned char sound_bank[] = {
+	0xAA,0xAA,0xAA,
+	0xCC,0xCC,0xCC,
+};
+
+unsigned char s_mask;		// bit of s_byte on the piezo, 0 = no sound playing
+unsigned char s_byte;		// byte being played
+unsigned int  s_pos;		// next byte of the clip in sound_bank[]
+unsigned int  s_end;		// and where it stops
+unsigned int  s_start;		// where it began, for s_loop
+unsigned char s_loop;		// start the clip again at its end
+
+#ifdef CHARLIE_PINS
+/*
+ Charlieplexed: CHARLIE_PINS pins from RB0 up drive N*(N-1) LEDs, one
+ LED between each ordered pair of pins, each pin through its own
+ resistor.  An LED is lit by driving its anode pin high and its cathode
+ pin low with every other LED pin an input; charlie_rom[] holds that
+ TRISB and PORTB image for each LED.  The pairs are in order of the
+ higher pin, so the first N*(N-1) entries are the LEDs on RB0..RB(N-1)
+ whatever N is, and LED n of a pattern is entry n.  Pins above the LED
+ pins stay outputs, low.
+ 
+ Pattern frames are one bit per LED, LED 0 in bit 0 of the first byte.
+ EYE() lights three neighbours at compile time.  A frame may light up to
+ CHARLIE_SLOTS LEDs; see led_poll().  charlie_rom[] and led_poll() work
+ for 3 to 6 pins, but pattern_rom[] is drawn for 6 (30 LEDs) and must be
+ redrawn for fewer, or its scans spend most of each sweep off the end.
+ 
+ pattern_index[] is [offset, length] in bytes of each pattern in
+ pattern_rom[], as sound_index[] is for the clips.
+*/
+#define CHARLIE_LEDS	(CHARLIE_PINS * (CHARLIE_PINS - 1))
+#define CHARLIE_MASK	((1 << CHARLIE_PINS) - 1)	// TRISB with every LED off
+#define CHARLIE(anode, cathode) \
+	CHARLIE_MASK & ~(1 << (anode) | 1 << (cathode)), 1 << (anode)
+#if CHARLIE_PINS < 3 || CHARLIE_PINS > 6
+#error CHARLIE_PINS must be 3..6: frames hold 32 LEDs
+#endif
+#if CHARLIE_LEDS != 30
+#error pattern_rom[] is drawn for CHARLIE_PINS 6 (30 LEDs): redraw it for others
+#endif
+
+const unsigned char charlie_rom[] = {
+	CHARLIE(0,1), CHARLIE(1,0), CHARLIE(0,2), CHARLIE(2,0),	// 0..3
+	CHARLIE(1,2), CHARLIE(2,1), CHARLIE(0,3), CHARLIE(3,0),	// 4..7
+	CHARLIE(1,3), CHARLIE(3,1), CHARLIE(2,3), CHARLIE(3,2),	// 8..11
+	CHARLIE(0,4), CHARLIE(4,0), CHARLIE(1,4), CHARLIE(4,1),	// 12..15
+	CHARLIE(2,4), CHARLIE(4,2), CHARLIE(3,4), CHARLIE(4,3),	// 16..19
+	CHARLIE(0,5), CHARLIE(5,0), CHARLIE(1,5), CHARLIE(5,1),	// 20..23
+	CHARLIE(2,5), CHARLIE(5,2), CHARLIE(3,5), CHARLIE(5,3),	// 24..27
+	CHARLIE(4,5), CHARLIE(5,4),							// 28..29
+	};
 
-// [t/10ms, f]
-unsigned char tune[] = {
-	100,2,100,0,100,3,100,0,0
+#define FRAME_BYTES	4
+#define DOT(n, i)	((((n) >> 3) == (i)) ? 1 << ((n) & 7) : 0)
+#define LIT3(a, b, c, i)	(DOT(a, i) | DOT(b, i) | DOT(c, i))
+#define FRAME3(a, b, c) \
+	LIT3(a, b, c, 0), LIT3(a, b, c, 1), LIT3(a, b, c, 2), LIT3(a, b, c, 3)
+#define EYE(p)	FRAME3((p) - 1, p, (p) + 1)
+
+#define PATTERN_SCAN		0	/* the eye, back and forth (repeats cleanly) */
+#define PATTERN_WIPE_UP		1	/* the eye, up the LEDs */
+#define PATTERN_WIPE_DOWN	2	/* and back down */
+#define PATTERN_IDLE		3	/* waiting for a mode */
+#define PATTERN_BLINK		4	/* power on */
+#define PATTERN_COUNT		5
+#define PATTERN_TAIL		PATTERN_SCAN	/* no levels here: the plain eye */
+
+const unsigned int pattern_index[] = {
+	0,216,
+	216,112,
+	328,112,
+	440,4,
+	444,8,
+};
+
+const unsigned char pattern_rom[] = {
+	// PATTERN_SCAN
+	EYE(1), EYE(2), EYE(3), EYE(4),
+	EYE(5), EYE(6), EYE(7), EYE(8),
+	EYE(9), EYE(10), EYE(11), EYE(12),
+	EYE(13), EYE(14), EYE(15), EYE(16),
+	EYE(17), EYE(18), EYE(19), EYE(20),
+	EYE(21), EYE(22), EYE(23), EYE(24),
+	EYE(25), EYE(26), EYE(27), EYE(28),
+	EYE(27), EYE(26), EYE(25), EYE(24),
+	EYE(23), EYE(22), EYE(21), EYE(20),
+	EYE(19), EYE(18), EYE(17), EYE(16),
+	EYE(15), EYE(14), EYE(13), EYE(12),
+	EYE(11), EYE(10), EYE(9), EYE(8),
+	EYE(7), EYE(6), EYE(5), EYE(4),
+	EYE(3), EYE(2),
+	// PATTERN_WIPE_UP
+	EYE(1), EYE(2), EYE(3), EYE(4),
+	EYE(5), EYE(6), EYE(7), EYE(8),
+	EYE(9), EYE(10), EYE(11), EYE(12),
+	EYE(13), EYE(14), EYE(15), EYE(16),
+	EYE(17), EYE(18), EYE(19), EYE(20),
+	EYE(21), EYE(22), EYE(23), EYE(24),
+	EYE(25), EYE(26), EYE(27), EYE(28),
+	// PATTERN_WIPE_DOWN
+	EYE(28), EYE(27), EYE(26), EYE(25),
+	EYE(24), EYE(23), EYE(22), EYE(21),
+	EYE(20), EYE(19), EYE(18), EYE(17),
+	EYE(16), EYE(15), EYE(14), EYE(13),
+	EYE(12), EYE(11), EYE(10), EYE(9),
+	EYE(8), EYE(7), EYE(6), EYE(5),
+	EYE(4), EYE(3), EYE(2), EYE(1),
+	// PATTERN_IDLE
+	FRAME3(7, 22, 22),
+	// PATTERN_BLINK
+	FRAME3(0, 14, 29), FRAME3(7, 15, 22),
+};
+
+#else
+/*
+ Pattern ROM: each frame is the brightness of the 10 LEDs, 0..15, two to
+ a byte with the first in the low nibble, left to right RA1 RA0 B7 .. B0.
+ LEVELS() packs the ten at compile time; FRAME() takes on/off LEDs as one
+ number (0x200 is RA1 alone, 0x001 B0) and makes them 15 or 0.
+ 
+ The ISR never reads these: when the sequencer moves to a frame,
+ led_poll() in main turns it into the BAM bit-planes below.
+ 
+ pattern_index[] is [offset, length] in bytes of each pattern in
+ pattern_rom[], as sound_index[] is for the clips.
+*/
+#define FRAME_BYTES	5
+#define LEVELS(l0,l1,l2,l3,l4,l5,l6,l7,l8,l9) \
+	(l0) | (l1) << 4, (l2) | (l3) << 4, (l4) | (l5) << 4, (l6) | (l7) << 4, (l8) | (l9) << 4
+#define ON(leds, n)	((((leds) >> (n)) & 1) * 15)
+#define FRAME(leds) \
+	LEVELS(ON(leds,9), ON(leds,8), ON(leds,7), ON(leds,6), ON(leds,5), \
+		ON(leds,4), ON(leds,3), ON(leds,2), ON(leds,1), ON(leds,0))
+
+#define PATTERN_SCAN		0	/* the eye, back and forth (repeats cleanly) */
+#define PATTERN_WIPE_UP		1	/* the eye, left to right */
+#define PATTERN_WIPE_DOWN	2	/* and right to left */
+#define PATTERN_IDLE		3	/* waiting for a mode */
+#define PATTERN_BLINK		4	/* power on */
+#define PATTERN_FILL		5	/* bar graph up and down */
+#define PATTERN_CENTRE		6	/* a pair out from the middle and back */
+#define PATTERN_ALTERNATE	7	/* odd and even LEDs */
+#define PATTERN_TAIL		8	/* one LED back and forth, fading behind */
+#define PATTERN_COUNT		9
+
+const unsigned int pattern_index[] = {
+	0,80,
+	80,50,
+	130,50,
+	180,5,
+	185,10,
+	195,100,
+	295,45,
+	340,10,
+	350,90,
+};
+
+const unsigned char pattern_rom[] = {
+	// PATTERN_SCAN
+	FRAME(0x300), FRAME(0x180), FRAME(0x0C0), FRAME(0x070),
+	FRAME(0x038), FRAME(0x00C), FRAME(0x006), FRAME(0x003),
+	FRAME(0x001), FRAME(0x003), FRAME(0x006), FRAME(0x00C),
+	FRAME(0x038), FRAME(0x070), FRAME(0x0C0), FRAME(0x180),
+	// PATTERN_WIPE_UP
+	FRAME(0x200), FRAME(0x300), FRAME(0x180), FRAME(0x0C0),
+	FRAME(0x070), FRAME(0x038), FRAME(0x00C), FRAME(0x006),
+	FRAME(0x003), FRAME(0x001),
+	// PATTERN_WIPE_DOWN
+	FRAME(0x001), FRAME(0x003), FRAME(0x006), FRAME(0x00C),
+	FRAME(0x038), FRAME(0x070), FRAME(0x0C0), FRAME(0x180),
+	FRAME(0x300), FRAME(0x200),
+	// PATTERN_IDLE
+	FRAME(0x084),
+	// PATTERN_BLINK
+	FRAME(0x1CE), FRAME(0x14A),
+	// PATTERN_FILL
+	FRAME(0x000), FRAME(0x200), FRAME(0x300), FRAME(0x380),
+	FRAME(0x3C0), FRAME(0x3E0), FRAME(0x3F0), FRAME(0x3F8),
+	FRAME(0x3FC), FRAME(0x3FE), FRAME(0x3FF), FRAME(0x3FE),
+	FRAME(0x3FC), FRAME(0x3F8), FRAME(0x3F0), FRAME(0x3E0),
+	FRAME(0x3C0), FRAME(0x380), FRAME(0x300), FRAME(0x200),
+	// PATTERN_CENTRE
+	FRAME(0x030), FRAME(0x048), FRAME(0x084), FRAME(0x102),
+	FRAME(0x201), FRAME(0x102), FRAME(0x084), FRAME(0x048),
+	FRAME(0x000),
+	// PATTERN_ALTERNATE
+	FRAME(0x2AA), FRAME(0x155),
+	// PATTERN_TAIL
+	LEVELS(15, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+	LEVELS( 7,15, 0, 0, 0, 0, 0, 0, 0, 0),
+	LEVELS( 3, 7,15, 0, 0, 0, 0, 0, 0, 0),
+	LEVELS( 1, 3, 7,15, 0, 0, 0, 0, 0, 0),
+	LEVELS( 0, 1, 3, 7,15, 0, 0, 0, 0, 0),
+	LEVELS( 0, 0, 1, 3, 7,15, 0, 0, 0, 0),
+	LEVELS( 0, 0, 0, 1, 3, 7,15, 0, 0, 0),
+	LEVELS( 0, 0, 0, 0, 1, 3, 7,15, 0, 0),
+	LEVELS( 0, 0, 0, 0, 0, 1, 3, 7,15, 0),
+	LEVELS( 0, 0, 0, 0, 0, 0, 1, 3, 7,15),
+	LEVELS( 0, 0, 0, 0, 0, 0, 0, 0,15, 7),
+	LEVELS( 0, 0, 0, 0, 0, 0, 0,15, 7, 3),
+	LEVELS( 0, 0, 0, 0, 0, 0,15, 7, 3, 1),
+	LEVELS( 0, 0, 0, 0, 0,15, 7, 3, 1, 0),
+	LEVELS( 0, 0, 0, 0,15, 7, 3, 1, 0, 0),
+	LEVELS( 0, 0, 0,15, 7, 3, 1, 0, 0, 0),
+	LEVELS( 0, 0,15, 7, 3, 1, 0, 0, 0, 0),
+	LEVELS( 0,15, 7, 3, 1, 0, 0, 0, 0, 0),
+};
+#endif
+
+// Pattern sequencer, stepped by the ISR.  seq_play() looks a pattern up
+// and the ISR shows its first frame on the next tick, then moves to a new
+// frame every q_ticks ticks, from the top again after the last.  Main
+// only has to say what to show, so it never waits out a sweep.
+#define SEQ_NONE	0xFF			// no pattern, for cylon()
+unsigned char q_ticks;			// ticks per frame
+unsigned char q_wait;			// ticks to the next frame, 0 = stopped
+unsigned int  q_f;				// next frame, byte offset in pattern_rom[]
+unsigned int  q_start;			// first frame of the pattern
+unsigned int  q_end;			// and the offset after its last
+unsigned int  q_frame;			// frame the sequencer is on
+unsigned char q_due;			// q_frame has been set since led_poll()
+unsigned int  q_shown;			// frame the LEDs were last set from
+
+#ifdef CHARLIE_PINS
+// Charlieplex slots: the ISR shows one a tick, in turn.  A slot is the
+// TRISB and PORTB image of one lit LED, or all LED pins off.
+#define CHARLIE_SLOTS	10
+unsigned char c_tris[CHARLIE_SLOTS];
+unsigned char c_port[CHARLIE_SLOTS];
+unsigned char c_k;				// slot on show
+#else
+
+// BAM (binary code modulation) brightness.  Bit k of every LED's level
+// is one bit-plane, a PORTA and a PORTB image, shown for 2^k ticks, so
+// each LED is lit for level ticks of every 15 and the ISR writes the
+// port once per plane whatever the pattern.  The tick is the tone
+// engine's 512us, so 4 bits is a 7.7ms (130Hz) cycle; 5 would be 63Hz
+// and 6 31Hz, which flicker.
+#define BAM_BITS	4
+unsigned char bam_a[BAM_BITS];	// RA0/RA1 of each plane
+unsigned char bam_b[BAM_BITS];	// PORTB of each plane
+unsigned char bam_k;			// plane on show
+unsigned char bam_bit;			// 1 << bam_k
+unsigned char bam_left;			// ticks left of it
+unsigned char bam_level[10];	// levels of the frame, LED order
+
+// Crossfade, all in main so it costs the ISR nothing.  From the frame
+// due to the one after it, each LED's fade value steps from level *
+// FADE_STEPS by (next level - level), FADE_STEPS times a frame, and
+// gamma_lut[] turns it into the BAM level.  FADE_STEPS and gamma_lut[]
+// come from WaveEdit -gamma 2.2 gamma.h.
+#include "gamma.h"
+unsigned char fade_v[10];		// LED order, into gamma_lut[]
+signed char   fade_d[10];		// added each step
+unsigned char fade_moving;		// any fade_d not 0
+unsigned char fade_s;			// steps taken this frame
+unsigned char fade_len;			// ticks per step
+unsigned char fade_at;			// q_wait at or below which to take the next
+#endif
+
+// DDS voice.  RA6 follows the top bit of a 16-bit phase that advances
+// by its increment every tick, so f = inc * 1953.125 / 65536 Hz (0.03Hz
+// steps) at the 4MHz, PS 000 tick.  Up to the 976Hz Nyquist limit any
+// pitch is available; the edges land on tick boundaries, so high notes
+// are a little rough.
+//
+// Volume is a duty cycle across the piezo: RA7 plays the same square
+// wave env_level/256 of a cycle ahead, so the piezo sees +V then -V
+// pulses of that width and 0V between.  The fundamental goes as
+// sin(pi * env_level / 256): VOL_MAX (half a cycle) is RA7 the inverse
+// of RA6, twice the swing of one pin, and 0 is both pins together,
+// silent with no DC.  A pulse narrower than a tick is dithered by the
+// phase, so quiet high notes are coarse.
+unsigned int phase0;
+unsigned int inc0;				// 0 holds the voice still
+unsigned char t_out;
+
+// ADSR envelope, stepped every 16 ticks (8.2ms) rather than every tick.
+// Attack climbs to VOL_MAX, decay falls to the sustain level, which holds
+// until the note is released; release falls to 0 and stops the voice.
+// The rates are level steps per 8.2ms, 1..VOL_MAX.
+#define VOL_MAX			128
+#define ENV_OFF			0
+#define ENV_ATTACK		1
+#define ENV_DECAY		2
+#define ENV_SUSTAIN		3
+#define ENV_RELEASE		4
+
+// attack, decay, sustain level, release; offsets for env_use()
+#define ENV_PLUCK		0		// the tune: 16ms in, 130ms to 1/4, 70ms out
+#define ENV_SWELL		4		// alarms: 0.5s in, held, 0.5s out
+const unsigned char env_shapes[] = {
+	64, 6, 32, 4,
+	2, 128, 128, 2
 	};
+
+unsigned char env_a, env_d, env_s, env_r;	// the shape in use
+unsigned char env_stage;
+unsigned char env_level;		// 0..VOL_MAX
+
+// note_inc[] and the packed tune[], from cylon.rtttl by
+// WaveEdit -pic 4000000 0 -rtttl cylon.rtttl tune.h
+#include "tune.h"
+
+// 1/32 notes for each length code, the top 3 bits of a tune[] byte
+const unsigned char tune_len[] = { 1, 2, 4, 8, 16, 32, 6, 12 };
+unsigned char t_note;			// the tune[] byte being played
+unsigned char t_tempo;			// ticks per 1/32 note, tune[0]
+unsigned char t_sub;			// ticks left of this 1/32
+unsigned char t_left;			// 1/32s left of this note
+unsigned char t_last;			// note index playing, to tie repeats
 	
 unsigned char t;
 unsigned char t0;
@@ -60,57 +381,171 @@ static void isr(void) interrupt 0 {
     T0IF = 0; 
     Cnt++;
 	
-	if (Cnt%2==2)
+	if ((Cnt & 1) == 0)		// every other tick, ~1ms
 	{
 		if (Msec >0) Msec--;
 	}
 	
-	if (Cnt%8==8)  // every 4ms = 250 B/s sample input
+	if (((unsigned char)Cnt & 7) == 0)  // every 8 ticks, ~4ms = 250 b/s sample input
 	{
-		c_byte<<2;
-		c_byte |= ((PORTA & 0x04)>>2);
+		c_byte = (c_byte << 1) | ((PORTA & 0x04) >> 2);	// RA2, oldest bit on top
 		
-		if (cbyte==0xAA) // start received
+		if (c_byte == 0xAA) // start received
+		{
+			// nothing reads the input yet, see readMode()
+		}
+	}
+	
+	
+	/*
+	Tone engine, every tick: the phase advances and RA6/RA7 are written
+	once, so it costs the same whatever the note and volume.  The tune
+	plays one tune[] byte per note: dddnnnnn, note_inc[n] for tune_len[d]
+	1/32 notes of tune[0] ticks each.  A new note starts the attack, a
+	rest (n = 31) or the 0 byte at the end releases the last one.  A
+	repeat of the same note is held on, so RTTTL ties do not re-attack.
+	
+	Worst case at 4MHz, 512 cycles per tick, estimated by hand from the
+	PIC instructions these statements need (neither counted from sdcc
+	output nor timed with the gpsim stopwatch, see isr.c, so treat them
+	as rough): context save/restore ~25, Cnt and Msec ~20, the RA2
+	sample (one tick in 8) ~10, phase, volume and port ~20, 1/32 count
+	~8, envelope step (one tick in 16) ~30, and on a note boundary one
+	tune[], one tune_len[] and one note_inc[] read through the code
+	pointer helpers ~125; a sound clip ~12 more, or ~60 on the tick it
+	reads a byte; the sequencer ~8, ~25 on a frame tick; BAM ~5, ~25 on
+	the 4 ticks in 15 that start a plane.  So ~350 cycles (68%) if all of
+	those fall on one tick and ~100 (20%) most ticks.  The charlieplex
+	slot instead of BAM is ~25 every tick.
+	
+	The code pointer reads are the least certain terms, so the ISR is
+	held to at most four of them a tick: the three of a note boundary and
+	one sound_bank[] byte.  A pattern start, ~110 more, is never one of
+	them; seq_play() reads pattern_index[] in main.
+	
+	The BAM plane is stepped first so its PORTA bits go out with this
+	tick's sound bits.
+	
+	While a clip plays it has RA6/RA7, one bit per tick in anti-phase;
+	the tune keeps time underneath and is heard again when it ends.
+	*/
+	if (q_wait != 0 && --q_wait == 0)
+	{
+		q_wait = q_ticks;
+		if (q_f == q_end)
+			q_f = q_start;
+		q_frame = q_f;					// main sets the LEDs from it
+		q_due = 1;
+		q_f += FRAME_BYTES;
+	}
+	
+#ifdef CHARLIE_PINS
+	TRISB = CHARLIE_MASK;		// all off while PORTB changes, no ghosts
+	PORTB = c_port[c_k];
+	TRISB = c_tris[c_k];
+	if (++c_k == CHARLIE_SLOTS)
+		c_k = 0;
+#else
+	if (--bam_left == 0)
+	{
+		bam_bit <<= 1;
+		bam_k++;
+		if (bam_k == BAM_BITS)
 		{
+			bam_bit = 1;
+			bam_k = 0;
 		}
+		bam_left = bam_bit;
+		led_a = bam_a[bam_k];			// into PORTA below
+		PORTB = bam_b[bam_k];
 	}
+#endif
 	
+	phase0 += inc0;
+	t_out = led_a;
+	if (phase0 & 0x8000) t_out |= 0x40;
+	if (((unsigned char)(phase0 >> 8) + env_level) & 0x80) t_out |= 0x80;
 	
-	if(t==1)
+	if (s_mask != 0)
 	{
-		wln=tune[t-1];
-		wlc=tune[t];
-		t+=2;
+		s_mask <<= 1;
+		if (s_mask == 0)
+		{
+			if (s_pos == s_end && s_loop)
+				s_pos = s_start;
+			if (s_pos != s_end)
+			{
+				s_byte = sound_bank[s_pos++];
+				s_mask = 1;
+			}
+		}
+		t_out &= 0x3F;
+		if (s_byte & s_mask)
+			t_out |= 0x80;		// RA7 on, RA6 off
+		else if (s_mask != 0)
+			t_out |= 0x40;		// RA6 on, RA7 off
 	}
+	PORTA = t_out;
 	
-	if (t>0 ) //
+	if (env_stage != ENV_OFF && ((unsigned char)Cnt & 15) == 0)
 	{
-		if (wlc!=0)
+		if (env_stage == ENV_ATTACK)
 		{
-			if (wlc >0) 
+			if (env_level >= VOL_MAX - env_a)
 			{
-				wlc--;
-				if (wlc==0) 
-				{
-					PORTA ^= 0X40; 		// flip bit A6;
-					
-					wln--;
-					if (wln==0)
-					{
-						wln=tune[t-1];	
-						if (wln != 0) 
-							wlc=tune[t];
-						t+=2;
-					}
-					else
-						wlc=tune[t-2];
-				}
+				env_level = VOL_MAX;
+				env_stage = ENV_DECAY;
 			}
+			else
+				env_level += env_a;
 		}
-		else
+		else if (env_stage == ENV_DECAY)
 		{
-			if (wln>0) {
-				wln--;
+			if (env_level - env_s <= env_d)
+			{
+				env_level = env_s;
+				env_stage = ENV_SUSTAIN;
+			}
+			else
+				env_level -= env_d;
+		}
+		else if (env_stage == ENV_RELEASE)
+		{
+			if (env_level <= env_r)
+			{
+				env_level = 0;
+				env_stage = ENV_OFF;
+				inc0 = 0;		// both pins level, no DC across the piezo
+			}
+			else
+				env_level -= env_r;
+		}
+	}
+	
+	if (t != 0 && --t_sub == 0)
+	{
+		t_sub = t_tempo;
+		if (--t_left == 0)
+		{
+			t_note = tune[t];
+			if (t_note != 0)
+			{
+				t_left = tune_len[t_note >> 5];
+				t_note &= 31;
+				if (t_note == 31)
+					env_stage = ENV_RELEASE;	// a rest rings the last note out
+				else if (t_note != t_last || env_stage == ENV_RELEASE || env_stage == ENV_OFF)
+				{
+					inc0 = note_inc[t_note];
+					env_stage = ENV_ATTACK;
+				}
+				t_last = t_note;
+				t++;
+			}
+			else
+			{
+				env_stage = ENV_RELEASE;
+				t = 0; //finished
 			}
 		}
 	}
@@ -118,8 +553,70 @@ static void isr(void) interrupt 0 {
 	
 }
 
+// Stops the tune and silences the piezo at once, with no release.
+void tune_stop(void)
+{
+	t = 0;
+	env_stage = ENV_OFF;
+	env_level = 0;
+	inc0 = 0;
+}
+
+// Starts clip sound_id playing from the ISR, once or (loop non-zero)
+// until sound_stop(); main and the LED scanner carry on meanwhile.
+void sound_start(unsigned char sound_id, unsigned char loop)
+{
+	unsigned char i = sound_id << 1;
+	
+	T0IE = 0;
+	s_pos = sound_index[i];
+	s_start = s_pos;
+	s_end = s_pos + sound_index[i + 1];
+	s_loop = loop;
+	s_mask = 0x80;			// first tick fetches the first byte
+	T0IE = 1;
+}
+
+// Stops a clip at the end of the current pass, or with now set at once.
+void sound_stop(unsigned char now)
+{
+	T0IE = 0;
+	s_loop = 0;
+	if (now)
+		s_mask = 0;
+	T0IE = 1;
+}
+
+// Loads an envelope shape, ENV_PLUCK or ENV_SWELL, for the next attack.
+void env_use(unsigned char shape)
+{
+	env_a = env_shapes[shape];
+	env_d = env_shapes[shape+1];
+	env_s = env_shapes[shape+2];
+	env_r = env_shapes[shape+3];
+}
+
+// Fades note n of note_inc[] in with the given shape, for an alarm;
+// it sustains until tone_off().  Stop the tune first.
+void tone_on(unsigned char n, unsigned char shape)
+{
+	env_use(shape);
+	inc0 = note_inc[n];
+	env_stage = ENV_ATTACK;
+}
+
+// Fades the tone out at the shape's release rate.
+void tone_off(void)
+{
+	env_stage = ENV_RELEASE;
+}
+
 
 void init(void) {
+#ifdef CHARLIE_PINS
+	unsigned char i;
+#endif
+	
 	/* PORTB.1 is an output pin */ 
 	TRISB = 0x00; 			// all outputs
 	TRISA = 0x04; 			// RA0/1 are outputs RA2 will be input, RA6/RA7 Drive piezo transducer
@@ -154,16 +651,188 @@ void init(void) {
     PS1 = 0;  
     PS0 = 0;  
 
+	// LED and tune state first: from T0IE on, every tick steps the
+	// sequencer and the tune and shows a BAM plane or charlieplex slot.
+	led_a=0;
+	q_wait=0;
+	q_due=0;
+	q_shown=0xFFFF;
+#ifdef CHARLIE_PINS
+	for (i=0; i<CHARLIE_SLOTS; i++) {
+		c_tris[i]=CHARLIE_MASK;
+		c_port[i]=0;
+	}
+	c_k=0;
+	TRISB=CHARLIE_MASK;
+#else
+	bam_k=BAM_BITS-1;
+	bam_bit=1<<(BAM_BITS-1);
+	bam_left=1;
+	fade_moving=0;
+#endif
+	tune_stop();
+	s_mask=0;				// no clip
+
     INTCON = 0;             /* clear interrupt flag bits */
     GIE = 1;                /* global interrupt enable */
     T0IE = 1;               /* TMR0 overflow interrupt enable */
     TMR0 = 0;               /* clear the value in TMR0 */
-	t=0;
 	Mode=0;
 	Cnt=0;
 	c_byte=0;
 }
 
+#ifdef CHARLIE_PINS
+// Sets the slots from the frame the sequencer has moved to.  Every lit
+// LED gets one of the CHARLIE_SLOTS ticks and the rest are dark, so each
+// is on 1/CHARLIE_SLOTS of the time however many are lit, and the duty
+// does not change from frame to frame.  LEDs past the first
+// CHARLIE_SLOTS lit in a frame are not shown.  Call it from anything
+// main loops in.
+void led_poll(void)
+{
+	unsigned int f;
+	unsigned char j, m, v, n, k;
+	unsigned char slot_tris[CHARLIE_SLOTS], slot_port[CHARLIE_SLOTS];
+	
+	if (!q_due)
+		return;
+	T0IE = 0;
+	f = q_frame;
+	q_due = 0;
+	T0IE = 1;
+	if (f == q_shown)
+		return;
+	q_shown = f;
+	
+	k = 0;
+	for (j = 0; j < FRAME_BYTES; j++) {
+		v = pattern_rom[f + j];
+		for (m = 0; m < 8 && k < CHARLIE_SLOTS; m++, v >>= 1) {
+			n = (j << 3) + m;
+			if ((v & 1) && n < CHARLIE_LEDS) {
+				slot_tris[k] = charlie_rom[n << 1];
+				slot_port[k] = charlie_rom[(n << 1) + 1];
+				k++;
+			}
+		}
+	}
+	for (; k < CHARLIE_SLOTS; k++) {
+		slot_tris[k] = CHARLIE_MASK;
+		slot_port[k] = 0;
+	}
+	
+	T0IE = 0;
+	for (k = 0; k < CHARLIE_SLOTS; k++) {
+		c_tris[k] = slot_tris[k];
+		c_port[k] = slot_port[k];
+	}
+	T0IE = 1;
+}
+#else
+
+// Unpacks the frame at byte offset f of pattern_rom[] into bam_level[].
+void bam_levels(unsigned int f)
+{
+	unsigned char j, v;
+	
+	for (j = 0; j < 10; j += 2) {
+		v = pattern_rom[f++];
+		bam_level[j] = v & 15;
+		bam_level[j + 1] = v >> 4;
+	}
+}
+
+// Turns bam_level[] into the bit-planes the ISR shows: plane k has each
+// LED's bit k where the LED's port bit is.  Built aside, then copied in
+// with T0IE off so the ISR never shows half of a plane.
+void bam_planes(void)
+{
+	unsigned char k, j, m, a, b;
+	unsigned char plane_a[BAM_BITS], plane_b[BAM_BITS];
+	
+	for (k = 0, m = 1; k < BAM_BITS; k++, m <<= 1) {
+		a = 0;
+		if (bam_level[0] & m) a |= 2;	// RA1
+		if (bam_level[1] & m) a |= 1;	// RA0
+		b = 0;
+		for (j = 2; j < 10; j++) {		// B7 .. B0
+			b <<= 1;
+			if (bam_level[j] & m) b |= 1;
+		}
+		plane_a[k] = a;
+		plane_b[k] = b;
+	}
+	
+	T0IE = 0;
+	for (k = 0; k < BAM_BITS; k++) {
+		bam_a[k] = plane_a[k];
+		bam_b[k] = plane_b[k];
+	}
+	T0IE = 1;
+}
+
+// Sets the planes from fade_v[] through the gamma table.
+void fade_show(void)
+{
+	unsigned char j;
+	
+	for (j = 0; j < 10; j++)
+		bam_level[j] = gamma_lut[fade_v[j]];
+	bam_planes();
+}
+
+// Starts the fade from frame f to frame n, offsets in pattern_rom[].
+void fade_start(unsigned int f, unsigned int n)
+{
+	unsigned char j;
+	
+	bam_levels(n);
+	for (j = 0; j < 10; j++)
+		fade_d[j] = bam_level[j];
+	bam_levels(f);
+	fade_moving = 0;
+	for (j = 0; j < 10; j++) {
+		fade_v[j] = bam_level[j] * FADE_STEPS;
+		fade_d[j] -= bam_level[j];
+		fade_moving |= fade_d[j];
+	}
+	fade_s = 0;
+	fade_len = q_ticks / FADE_STEPS;
+	fade_at = q_ticks - fade_len;
+}
+
+// Builds the planes when the sequencer moves to a new frame, and for
+// each crossfade step after that.  Call it from anything main loops in.
+void led_poll(void)
+{
+	unsigned int f, n;
+	unsigned char j;
+	
+	if (q_due) {
+		T0IE = 0;
+		f = q_frame;
+		n = q_f;					// the frame after, unless it wraps
+		if (n == q_end)
+			n = q_start;
+		q_due = 0;
+		T0IE = 1;
+		if (f != q_shown || fade_moving) {
+			q_shown = f;
+			fade_start(f, n);
+			fade_show();
+		}
+	}
+	else if (fade_moving && fade_s < FADE_STEPS - 1 && q_wait <= fade_at) {
+		fade_s++;
+		fade_at -= fade_len;
+		for (j = 0; j < 10; j++)
+			fade_v[j] += fade_d[j];
+		fade_show();
+	}
+}
+#endif
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -179,11 +848,18 @@ void delay(unsigned char ms)
 	
 	while (Msec) 
 	{
+		led_poll();
 	}  
 }
 
+// Starts tune[] from the top; t is set last so the ISR sees a whole start.
 void play_tone()
 {
+	env_use(ENV_PLUCK);
+	t_last = 0;
+	t_tempo = tune[0];
+	t_sub = 1;
+	t_left = 1;
 	t=1;
 }
 
@@ -195,6 +871,34 @@ void readMode()
 
 
 #define CYLON_SCAN_DELAY 25
+#ifdef CHARLIE_PINS
+#define CYLON_SCAN_TICKS 20		// three times the LEDs, so quicker
+#else
+#define CYLON_SCAN_TICKS (CYLON_SCAN_DELAY * 2)	// delay() counts ~1ms in 2 ticks
+#endif
+#define BLINK_TICKS 100
+
+// Pattern shown for each Mode
+const unsigned char mode_pattern[] = {
+	PATTERN_IDLE, PATTERN_TAIL, PATTERN_WIPE_UP, PATTERN_WIPE_DOWN
+	};
+
+// Starts pattern id on the next tick, a frame every ticks ticks, in
+// place of whatever is showing.  pattern_index[] is read here, not in
+// the ISR, which keeps its worst tick down (see isr()).
+void seq_play(unsigned char id, unsigned char ticks)
+{
+	unsigned int start = pattern_index[id << 1];
+	unsigned int end = start + pattern_index[(id << 1) + 1];
+	
+	T0IE = 0;
+	q_start = start;
+	q_end = end;
+	q_f = start;
+	q_ticks = ticks;
+	q_wait = 1;
+	T0IE = 1;
+}
 
 /*
 
@@ -211,146 +915,36 @@ void readMode()
  A2 control inut
  A6/7 Sound output
  
+ Built with -DCHARLIE_PINS=6: 30 LEDs charlieplexed on
+ B0-B5, see charlie_rom[]; A0-A1 are free, B6-B7 outputs held low.
+ 
 */ 
 
-#define MASK_A (unsigned char)0xFC
-#define MASK_B (unsigned char)0x00
-
-
-
 void start() {
 
-	unsigned char i; // array iterator
-/* 10 bits */
-unsigned char cylon_bits_a[] = { 2,3,  1,  0,  0, 0, 0,0,0,0 };
-unsigned char cylon_bits_b[] = { 0,0,128,192,112,56,12,6,3,1 };
-
-unsigned char mask_a = 0xfc;
-unsigned char mask_b = 0x00;
+	unsigned char m = SEQ_NONE;	// Mode on show, none yet
 
 	while(1) {
 	
-		play_tone();
-
-	
-		while (Mode==0) // wait until mode set
-		{
-			PORTA = 0;
-			PORTB = 132;  //00 10000100
-			delay(CYLON_SCAN_DELAY);		
-		}
-		
-		play_tone();
-	
-
-		if(Mode == 1) {
-
-			// traditional (back & forth) cylon scanner
-
-			for(i = 1; i < sizeof(cylon_bits_a); i++) {
+		// Nothing here blocks, so a new Mode is seen at once and its
+		// pattern starts on the next tick.  Other work can go in this
+		// loop; Timer0 stops in SLEEP, so it cannot sleep between ticks.
+		led_poll();
+		if (m != Mode) {
+			m = Mode;
+			seq_play(mode_pattern[m], CYLON_SCAN_TICKS);
+			play_tone();
 			
-			
-				PORTA &= MASK_A;
-				PORTA |= cylon_bits_a[i];
-				PORTB &= MASK_B;
-				PORTB |= cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
-
-			for(i = sizeof(cylon_bits_a) - 2; i > 1; i--) {
-				PORTA &= MASK_A;
-				PORTA |= cylon_bits_a[i];
-				PORTB &= MASK_B;
-				PORTB |= cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
-
-		} else if(Mode == 2) {
-
-			// single direction scan
-
-			for(i = 0; i < sizeof(cylon_bits_a); i++) {
-				PORTA &= MASK_A;
-				PORTA |= cylon_bits_a[i];
-				PORTB &= MASK_B;
-				PORTB |= cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
-
-
-		} else if(Mode == 3) {
-
-			// other direction scan
-
-			for(i = sizeof(cylon_bits_a); i > 0; i--) {
-				PORTA &= MASK_A;
-				PORTA |= cylon_bits_a[i];
-				PORTB &= MASK_B;
-				PORTB |= cylon_bits_b[i];
-				delay(CYLON_SCAN_DELAY);
-			}
+			if (m == 1)
+				sound_start(SOUND_HUM, 1);	// the back & forth scan hums
+			else
+				sound_stop(0);
 		}
 	}
 }
 
 
 
-//__code __at (0x300) unsigned char sound_bytes_0[] = { 0xAA, 0xAA, 0xAA};
-//__code __at (0x310) unsigned char sound_bytes_1[] = { 0xCC, 0xCC, 0xCC};
-
-/*
-
-void play_sound(unsigned char sound_id, int ptime) {
-
-unsigned char sound_bytes_0[] = { 0xAA, 0xAA, 0xAA};
-unsigned char sound_bytes_1[] = { 0xCC, 0xCC, 0xCC};
-
-		
-	// play sound from array
-	int sz;
-	char *sb;
-	
-	switch(sound_id) {
-	case 0:
-		sz = sizeof(sound_bytes_0);
-		sb = &sound_bytes_0[0];
-		break;
-	case 1:
-		sz = sizeof(sound_bytes_1);
-		sb = &sound_bytes_1[0];
-		break;
-	}
-	
-	s_mask=1;
-		
-	while (ptime-- > 0)
-	{
-		if (s_mask==0)
-		{
-			s_mask=1;
-			s_bytes++;
-			if ((s_bytes-sb) >= sz)
-				s_bytes=sb;
-		}
-		if ((s_mask & *s_bytes) != 0)
-		{
-			PORTA |= 0x80;  		//Bit 7 On
-			PORTA &= 0xBF;  		//Bit 6 Off
-		}
-		else
-		{
-			PORTA &= 0x7F;  		//Bit 7 Off
-			PORTA |= 0x40;  		//Bit 6 On
-		}
-
-		s_mask <<= 1;	
-		
-		delay(1);
-	}
-}
-
-*/
-
 
 void main(void) {
 	int i=0; 
@@ -359,17 +953,10 @@ void main(void) {
 	Mode=0;
 	Cnt=0;
 	
+	seq_play(PATTERN_BLINK, BLINK_TICKS);
 	for (i=0; i<30; i++)
 	{
 		delay(50);
-		if (i%2==0) {
-			PORTA = 1;
-			PORTB = 206;  //00 10000100
-		}
-		else {
-			PORTA = 1;
-			PORTB = 74;  //00 10000100
-		}
 	}
 	Mode=0;
 	Cnt=0;
@@ -112,10 +112,26 @@ const unsigned char sound[] = {
  
 
 
+#include "sounds.h"		/* WaveEdit -lz -bank sounds.h eye.wav hello.wav */
+
 unsigned char Msec;
-unsigned char s_mask;
-char *s_bytes, *s_bytes_;
-unsigned char c_byte;
+unsigned char s_mask;		// bit of c_byte on the piezo, 0 = no sound playing
+unsigned int  s_pos;		// next byte of the clip in sound_bank[]
+unsigned int  s_end;		// and where it stops
+unsigned int  s_start;		// where it began, for s_loop
+unsigned char s_loop;		// start the clip again at its end
+unsigned char c_byte;		// byte being played
+unsigned char t_byte;		// token being decoded
+
+#ifdef SOUND_LZ
+unsigned char s_lit;		// literal bytes left in the current token
+unsigned char s_copy;		// copied bytes left in the current token
+unsigned char s_dist;		// and how far back they come from
+unsigned char s_rp;			// s_ring write index, wraps at 256
+unsigned char s_ring[32];	// last 32 bytes decoded, copies are read from here
+unsigned char n_byte;		// byte to play after c_byte
+unsigned char n_state;		// 0 = n_byte still to decode, 1 = ready, 2 = end of clip
+#endif
 
 unsigned char  wlc;  //wave length in 0.5us i.e. 1Khz = 0.5us on, 0.5us off -> L=1ms => 1Khz
 
@@ -130,7 +146,97 @@ static void isr(void) interrupt 0 {
     T0IF = 0;               /* Clear timer interrupt flag */     
 	if (Msec >0) Msec--;
 	
-	PORTA ^= 0X80;  // 1khz
+	/*
+	One bit of the clip per tick, RA6/RA7 driven in anti-phase, and a
+	new byte every 8th tick.  At the end of a looped clip s_pos goes
+	back to s_start, a 16-bit compare and copy.
+	
+	With SOUND_LZ the next byte is decoded ahead, one step a tick on the
+	ticks between bytes: a ring copy, a literal, or a token.  A token
+	and the literal after it take two ticks, so no tick reads
+	sound_bank[] more than once, and the byte tick itself only moves
+	n_byte into c_byte.  Two steps at most are needed of the seven.
+	
+	Budget at 4MHz, 512 cycles per tick, estimated by hand for the sdcc
+	output including context save (not yet timed with the gpsim
+	stopwatch, see isr.c): plain bit ~30 cycles, ring copy ~60, token or
+	literal ~75 with its one sound_bank[] read, so ~75 (15%) at worst.
+	*/
+	if (s_mask != 0)
+	{
+		s_mask <<= 1;
+#ifdef SOUND_LZ
+		if (s_mask == 0)
+		{
+			if (n_state == 1)
+			{
+				c_byte = n_byte;
+				n_state = 0;
+				s_mask = 1;
+			}
+			// else end of clip, s_mask stays 0
+		}
+		else if (n_state == 0)
+		{
+			if (s_copy != 0)
+			{
+				s_copy--;
+				n_byte = s_ring[(unsigned char)(s_rp - s_dist) & 31];
+				n_state = 1;
+			}
+			else if (s_lit != 0)
+			{
+				s_lit--;
+				n_byte = sound_bank[s_pos++];
+				n_state = 1;
+			}
+			else
+			{
+				if (s_pos == s_end && s_loop)
+					s_pos = s_start;
+				if (s_pos != s_end)
+				{
+					t_byte = sound_bank[s_pos++];
+					if (t_byte & 0x80)
+					{
+						// copy 2..5 bytes from 1..32 back, from the next tick
+						s_copy = ((t_byte >> 5) & 3) + 2;
+						s_dist = (t_byte & 31) + 1;
+					}
+					else
+						s_lit = t_byte + 1;		// 1..128 literals
+				}
+				else
+					n_state = 2;	// end of clip
+			}
+			if (n_state == 1)
+			{
+				s_ring[s_rp & 31] = n_byte;
+				s_rp++;
+			}
+		}
+#else
+		if (s_mask == 0)
+		{
+			s_mask = 1;
+			if (s_pos == s_end && s_loop)
+				s_pos = s_start;
+			if (s_pos != s_end)
+				c_byte = sound_bank[s_pos++];
+			else
+				s_mask = 0;		// end of clip
+		}
+#endif
+		
+		if (c_byte & s_mask)
+			PORTA = (PORTA & 0x3F) | 0x80;	// RA7 on, RA6 off
+		else if (s_mask != 0)
+			PORTA = (PORTA & 0x3F) | 0x40;	// RA6 on, RA7 off
+		else
+			PORTA &= 0x3F;					// finished, both off
+	}
+	else
+		PORTA ^= 0X80;  // 1khz
 
 	
 	if (wlc!=0)
@@ -154,6 +260,7 @@ void init(void) {
 	TRISB = 0x00; // all outputs
 	TRISA = 0x00; // all outputs
 	
+	s_mask = 0;
 	CMCON = 0x07;           /* disable comparators */
     T0CS = 0;               /* clear to enable timer mode */
     PSA = 0;                /* clear to assign prescaller to TMRO */
@@ -247,70 +354,59 @@ void play_tone()
 	// output on A4/A5 = PORTA = 0011 0000 
 }
 
-//__code __at (0x300) unsigned char sound_bytes_0[] = { 0xAA, 0xAA, 0xAA};
-//__code __at (0x310) unsigned char sound_bytes_1[] = { 0xCC, 0xCC, 0xCC};
-
-/*
+// ------------------------------------------------
+// start clip sound_id of sounds.h playing from the ISR, once or (loop
+// non-zero) until sound_stop(); main carries on meanwhile
 
-void play_sound(unsigned char sound_id, int ptime) {
+void sound_start(unsigned char sound_id, unsigned char loop)
+{
+	unsigned char i = sound_id << 1;
+	
+	T0IE = 0;
+	s_pos = sound_index[i];
+	s_start = s_pos;
+	s_end = s_pos + sound_index[i + 1];
+	s_loop = loop;
+#ifdef SOUND_LZ
+	s_lit = 0;
+	s_copy = 0;
+	s_rp = 0;
+	n_state = 0;
+	c_byte = 0x40;			// one tick each way while the first byte decodes
+	s_mask = 0x20;			// two ticks to decode it, a token and a byte
+#else
+	s_mask = 0x80;			// first tick fetches the first byte
+#endif
+	T0IE = 1;
+}
 
-unsigned char sound_bytes_0[] = { 0xAA, 0xAA, 0xAA};
-unsigned char sound_bytes_1[] = { 0xCC, 0xCC, 0xCC};
+// stop a clip at the end of the current pass, or with now set at once
 
-		
-	// play sound from array
-	int sz;
-	char *sb;
-	
-	switch(sound_id) {
-	case 0:
-		sz = sizeof(sound_bytes_0);
-		sb = &sound_bytes_0[0];
-		break;
-	case 1:
-		sz = sizeof(sound_bytes_1);
-		sb = &sound_bytes_1[0];
-		break;
-	}
-	
-	s_mask=1;
-		
-	while (ptime-- > 0)
+void sound_stop(unsigned char now)
+{
+	T0IE = 0;
+	s_loop = 0;
+	if (now)
 	{
-		if (s_mask==0)
-		{
-			s_mask=1;
-			s_bytes++;
-			if ((s_bytes-sb) >= sz)
-				s_bytes=sb;
-		}
-		if ((s_mask & *s_bytes) != 0)
-		{
-			PORTA |= 0x80;  		//Bit 7 On
-			PORTA &= 0xBF;  		//Bit 6 Off
-		}
-		else
-		{
-			PORTA &= 0x7F;  		//Bit 7 Off
-			PORTA |= 0x40;  		//Bit 6 On
-		}
-
-		s_mask <<= 1;	
-		
-		delay(1);
+		s_mask = 0;
+		PORTA &= 0x3F;		// both off
 	}
+	T0IE = 1;
 }
 
-*/
-
 
 void main(void) {
+	unsigned char id;
  
 	init();
 	
 	while (1) {	
-		//play_sound(0, 500);
-		//play_sound(1, 500);
+		for (id = 0; id < SOUND_COUNT; id++)
+		{
+			sound_start(id, 0);
+			while (s_mask != 0) ;
+			delay(50);
+		}
 		
 		play_tone();
 	}
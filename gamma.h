@@ -0,0 +1,24 @@
+/* Gamma 2.20 table written by WaveEdit -gamma, do not edit. */
+
+// Crossfade steps per frame; gamma_lut[] has 15 * FADE_STEPS + 1 entries
+#define FADE_STEPS	4
+
+// BAM duty 0..15 for each level * FADE_STEPS + step, ceil(15 * (v / 60) ^ 2.20)
+const unsigned char gamma_lut[] = {
+	0,1,1,1,	// 0
+	1,1,1,1,	// 1
+	1,1,1,1,	// 2
+	1,1,1,1,	// 3
+	1,1,2,2,	// 4
+	2,2,2,2,	// 5
+	2,3,3,3,	// 6
+	3,4,4,4,	// 7
+	4,5,5,5,	// 8
+	5,6,6,6,	// 9
+	7,7,7,8,	// 10
+	8,8,9,9,	// 11
+	10,10,11,11,	// 12
+	11,12,12,13,	// 13
+	13,14,14,15,	// 14
+	15,	// 15
+	};
@@ -0,0 +1,138 @@
+/* Sound bank generated by WaveEdit -bank, do not edit. */
+
+#define SOUND_HELLO	0	/* hello.wav, 1365 bytes */
+#define SOUND_COUNT	1
+#define SOUND_ADPCM	1	/* IMA ADPCM, 4 bits per sample, low nibble first */
+
+// [offset, length] in bytes of each clip in sound_bank[]
+const unsigned int sound_index[] = {
+	0,1365,
+};
+
+const unsigned char sound_bank[] = {
+	112,138,183,128,128,128,255,159,183,132,128,
+	64,8,128,61,12,8,8,8,8,8,248,
+	137,182,3,128,181,8,8,248,3,8,136,
+	224,72,128,128,8,128,8,128,183,128,232,
+	3,4,140,128,128,128,62,0,4,13,8,
+	8,8,8,8,8,8,8,8,8,8,112,
+	123,139,128,0,248,131,0,63,8,120,184,
+	180,48,12,8,8,8,8,136,63,128,128,
+	128,128,128,128,128,128,8,128,8,8,8,
+	8,128,128,128,0,0,0,0,0,0,0,
+	0,0,0,112,199,8,8,8,8,8,8,
+	128,128,128,167,8,8,248,255,141,7,128,
+	128,96,128,140,128,128,128,63,128,181,8,
+	8,104,11,8,196,128,128,128,128,128,143,
+	4,8,8,197,128,128,128,182,128,8,128,
+	232,8,88,128,128,128,6,60,59,128,13,
+	200,179,132,128,0,136,7,12,184,132,128,
+	64,128,140,128,128,14,8,132,64,192,3,
+	8,216,8,8,104,139,0,216,8,4,3,
+	61,139,128,128,128,128,128,128,128,128,128,
+	128,240,115,229,179,72,11,8,8,136,0,
+	136,0,136,112,229,3,8,216,128,128,224,
+	131,128,128,128,0,136,128,0,55,128,159,
+	76,184,132,139,0,4,8,8,120,11,132,
+	128,208,8,200,72,128,64,240,129,58,2,
+	12,195,58,195,128,192,72,11,67,139,128,
+	61,0,8,197,128,132,11,8,141,132,75,
+	8,8,4,8,216,180,59,180,8,8,14,
+	8,132,75,131,12,8,180,72,75,248,3,
+	170,165,139,133,9,132,137,2,11,131,12,
+	195,75,243,72,169,16,194,40,181,106,137,
+	24,9,8,168,104,169,2,8,139,52,143,
+	148,56,137,32,186,60,8,60,243,57,160,
+	130,123,137,2,130,59,240,72,155,8,15,
+	179,74,146,73,2,8,132,162,42,207,128,
+	232,17,128,0,149,129,57,33,72,132,207,
+	17,218,16,160,2,34,27,185,6,40,50,
+	4,249,43,200,13,0,144,66,163,74,162,
+	28,20,49,208,15,136,169,25,18,8,69,
+	154,34,202,65,0,130,249,11,178,156,48,
+	3,48,50,209,41,153,68,34,160,255,8,
+	168,26,17,20,49,152,17,218,9,37,17,
+	202,236,24,168,26,68,16,130,43,146,250,
+	128,83,0,186,188,1,156,89,35,131,162,
+	91,128,221,32,20,8,219,137,145,155,113,
+	34,136,161,56,185,175,50,20,145,174,42,
+	209,137,83,17,137,144,129,200,30,34,3,
+	193,158,33,203,25,37,130,9,168,129,218,
+	58,68,130,217,28,163,188,80,18,129,8,
+	138,160,251,64,51,144,250,73,169,170,36,
+	18,136,145,137,168,159,52,19,152,191,4,
+	202,25,51,1,8,137,137,249,43,53,18,
+	185,15,162,203,48,36,8,136,144,144,190,
+	104,34,1,250,40,184,155,81,3,128,152,
+	1,232,155,99,18,144,173,3,218,11,52,
+	2,152,24,128,251,43,53,1,232,42,161,
+	172,41,37,129,136,0,161,191,64,51,128,
+	204,32,184,157,72,20,144,8,16,216,156,
+	51,36,184,141,2,218,154,83,3,137,8,
+	1,251,10,37,130,217,24,128,188,41,84,
+	145,152,16,146,190,32,37,144,141,16,168,
+	188,81,19,144,9,48,217,156,82,18,201,
+	10,2,218,155,100,1,152,8,130,218,10,
+	68,129,156,24,145,218,25,53,145,153,48,
+	144,175,57,37,176,139,40,152,175,65,35,
+	152,138,50,233,156,81,3,186,137,17,217,
+	12,99,2,169,25,2,235,26,83,145,186,
+	40,129,189,74,53,145,155,17,146,175,40,
+	52,169,156,17,177,172,97,36,153,11,17,
+	192,156,81,2,186,10,19,216,12,115,1,
+	169,25,2,202,139,84,145,187,40,3,218,
+	41,39,161,155,32,145,173,57,38,184,140,
+	33,144,187,113,21,168,138,1,192,171,96,
+	18,185,26,20,192,155,99,2,186,41,2,
+	251,10,67,129,171,48,19,235,26,53,160,
+	156,49,161,174,25,37,160,154,67,161,172,
+	88,35,217,138,34,168,174,65,19,185,41,
+	67,218,155,82,2,187,41,4,233,138,83,
+	1,155,48,3,236,10,36,161,170,49,129,
+	190,57,37,160,139,37,144,189,40,36,185,
+	27,67,184,158,49,21,169,26,35,233,139,
+	104,1,170,56,19,219,140,83,129,154,56,
+	18,236,10,35,162,155,82,130,235,9,36,
+	161,139,67,177,221,40,19,184,26,37,160,
+	173,48,19,201,24,37,202,172,50,3,187,
+	64,20,217,139,66,147,140,56,148,250,9,
+	50,144,154,81,2,204,9,20,161,12,66,
+	160,187,57,6,152,11,53,161,159,40,2,
+	169,42,20,184,188,66,131,154,88,35,250,
+	154,81,0,186,80,16,186,11,52,161,156,
+	81,2,235,25,50,192,138,97,145,172,16,
+	50,192,137,52,192,187,72,35,188,40,53,
+	200,187,66,3,172,25,23,169,155,35,148,
+	140,16,133,185,170,53,152,170,98,131,203,
+	10,20,160,140,66,130,218,25,34,176,138,
+	100,152,188,33,36,170,138,39,176,156,72,
+	1,170,58,37,168,13,40,130,173,64,34,
+	216,137,34,210,170,82,130,202,10,36,168,
+	10,99,128,172,128,50,192,138,115,160,160,
+	42,48,236,128,20,128,172,34,131,192,58,
+	131,208,187,7,145,186,96,33,10,11,8,
+	128,140,112,131,186,138,36,192,202,51,131,
+	188,64,131,188,128,68,179,188,128,4,140,
+	0,83,179,12,56,0,189,136,53,8,188,
+	3,180,200,72,179,180,140,36,179,12,8,
+	8,216,8,4,8,141,64,3,200,72,128,
+	208,11,3,128,14,72,131,139,208,51,0,
+	141,64,8,188,8,132,0,141,64,8,8,
+	104,8,200,192,51,139,208,8,52,12,8,
+	88,8,188,36,3,143,160,130,128,192,48,
+	8,13,131,4,200,192,51,192,8,60,128,
+	140,128,5,8,8,104,128,128,13,195,192,
+	128,132,128,12,72,3,8,141,132,240,40,
+	8,2,139,128,128,224,8,88,8,8,88,
+	128,208,11,3,200,8,8,135,8,8,88,
+	128,12,8,180,136,76,8,8,141,64,8,
+	200,132,48,12,8,88,139,128,128,128,240,
+	136,80,8,8,133,128,208,48,208,128,139,
+	88,128,128,128,128,128,63,64,208,128,128,
+	128,128,62,128,0,136,128,183,128,128,135,
+	192,128,64,139,12,72,128,60,123,0,8,
+	59,139,8,13,3,8,232,48,128,181,8,
+	61,128,128,128,120,192,128,128,208,128,64,
+	8,8,8,120,128,12,8,132,139,128,128,
+	0,
+};
@@ -0,0 +1,155 @@
+using System;
+using System.IO;
+using System.Threading;
+using System.Globalization;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Searches level, decimation and encoder mode for the best sounding clip that fits a flash budget.
+	/// </summary>
+	/*
+	 * Every combination of encoder mode, window (samples per bit, so the
+	 * bit rate) and level is quantised from the clip in memory and, if it
+	 * fits the byte budget, scored with Fidelity.SegmentalSnr against the
+	 * source.  Candidates are shared out between one worker per core.
+	 *
+	 * Report() lists the Pareto front: the candidates no other one beats
+	 * on both size and score, smallest first, and marks the best score.
+	 */
+	public class AutoTuner
+	{
+		public class Candidate
+		{
+			public QuantiseSettings Settings = new QuantiseSettings();
+			public int Bytes;
+			public double Snr;
+		}
+
+		const int MaxWindow = 32;
+		const double VoiceBand = 3400;	//Hz, scoring low-pass
+
+		fmtChunk format;
+		byte[] raw;			//the data chunk
+		float[] source;		//and as one channel
+		int budget;
+		List<Candidate> candidates = new List<Candidate>();
+		int next = -1;		//last candidate taken by a worker
+
+		public AutoTuner(WaveFileReader reader, fmtChunk format, int budget)
+		{
+			this.format = format;
+			this.budget = budget;
+			raw = reader.ReadData();
+
+			int frame = (int)format.dwBitsPerSample / 8 * format.wChannels;
+			source = new float[raw.Length / frame];
+			Quantiser.Decode(raw, source.Length, format.wChannels, (int)format.dwBitsPerSample / 8, source);
+
+			//Smallest window whose output fits the budget, then every one up to MaxWindow.
+			long bits = (long)budget * 8;
+			int minWindow = (int)Math.Max(1, (source.Length + bits - 1) / Math.Max(1, bits));
+			for (int w = minWindow; w <= MaxWindow; w++)
+			{
+				for (int level = 116; level <= 140; level += 2)
+					add(QuantiseMode.Threshold, w, level);
+				for (int level = 126; level <= 130; level++)
+				{
+					add(QuantiseMode.SigmaDelta1, w, level);
+					add(QuantiseMode.SigmaDelta2, w, level);
+				}
+			}
+		}
+
+		void add(QuantiseMode mode, int window, int level)
+		{
+			Candidate c = new Candidate();
+			c.Settings.Mode = mode;
+			c.Settings.Window = window;
+			c.Settings.Level = level;
+			candidates.Add(c);
+		}
+
+		/*
+		 * void Run()
+		 * Quantises and scores every candidate, one worker thread per core.
+		 */
+		public void Run()
+		{
+			int workers = Math.Max(1, Math.Min(Environment.ProcessorCount, candidates.Count));
+			Thread[] threads = new Thread[workers];
+			for (int i = 0; i < workers; i++)
+			{
+				threads[i] = new Thread(new ThreadStart(work));
+				threads[i].Start();
+			}
+			for (int i = 0; i < workers; i++)
+				threads[i].Join();
+		}
+
+		void work()
+		{
+			int i;
+			while ((i = Interlocked.Increment(ref next)) < candidates.Count)
+			{
+				Candidate c = candidates[i];
+				MemoryStream packed = new MemoryStream();
+				new Quantiser(format, c.Settings).Run(new MemoryStream(raw, false), raw.Length, packed, 1 << 16);
+				c.Bytes = (int)packed.Length;
+				if (c.Bytes > budget)
+					continue;
+				float[] y = Fidelity.Reconstruct(packed.ToArray(), c.Settings.Window, source.Length);
+				c.Snr = Fidelity.SegmentalSnr(source, y, format.dwSamplesPerSec, VoiceBand);
+			}
+		}
+
+		/*
+		 * List<Candidate> ParetoFront()
+		 * Candidates inside the budget that nothing else is both smaller
+		 * (or as small) and better than, smallest first.
+		 */
+		public List<Candidate> ParetoFront()
+		{
+			List<Candidate> fits = new List<Candidate>();
+			foreach (Candidate c in candidates)
+				if (c.Bytes <= budget)
+					fits.Add(c);
+			fits.Sort(delegate(Candidate a, Candidate b)
+			{
+				return (a.Bytes != b.Bytes) ? a.Bytes.CompareTo(b.Bytes) : b.Snr.CompareTo(a.Snr);
+			});
+
+			List<Candidate> front = new List<Candidate>();
+			double best = double.NegativeInfinity;
+			foreach (Candidate c in fits)
+			{
+				if (c.Snr > best)
+				{
+					front.Add(c);
+					best = c.Snr;
+				}
+			}
+			return front;
+		}
+
+		/*
+		 * void Report(TextWriter)
+		 * Prints the front, with the WaveEdit options for each point.
+		 */
+		public void Report(TextWriter outfile)
+		{
+			CultureInfo inv = CultureInfo.InvariantCulture;
+			List<Candidate> front = ParetoFront();
+			outfile.WriteLine("budget " + budget + " bytes, " + candidates.Count + " candidates, " + front.Count + " on the front");
+			outfile.WriteLine("bytes\tbit/s\tsegSNR\tmode\twindow\tlevel");
+			for (int i = 0; i < front.Count; i++)
+			{
+				Candidate c = front[i];
+				outfile.WriteLine(c.Bytes + "\t" + (format.dwSamplesPerSec / c.Settings.Window) + "\t" + c.Snr.ToString("F2", inv) + "\t" + c.Settings.Mode + "\t" + c.Settings.Window + "\t" + c.Settings.Level + ((i == front.Count - 1) ? "\t<- best" : ""));
+			}
+			if (front.Count == 0)
+				outfile.WriteLine("nothing fits in " + budget + " bytes");
+		}
+	}
+}
@@ -0,0 +1,118 @@
+using System;
+using System.IO;
+using System.Diagnostics;
+using System.Globalization;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Times and scores every encoder mode over a fixed corpus of clips.
+	/// </summary>
+	/*
+	 * Each clip is read into memory once, then quantised by every mode,
+	 * both with the 11 sample window and resampled to the 4MHz Timer0
+	 * tick, enough times to take at least MinSeconds.  One line per run
+	 * goes to a tab separated file:
+	 *
+	 *   clip  mode  rate  in_bytes  out_bytes  mb_s  peak_kb  seg_snr
+	 *
+	 * mb_s is input megabytes (2^20) quantised per second on one thread.
+	 * peak_kb is the process peak working set once the run is done, so
+	 * it only grows down the file; a jump shows which run caused it.
+	 * seg_snr is Fidelity.SegmentalSnr of the bits played back through
+	 * a voice band low-pass, in dB, higher is better; Pcm runs at its
+	 * default 8 bits.  Diff two files to see what a change did.
+	 */
+	public sealed class Benchmark
+	{
+		public static readonly string[] Corpus = { "eye.wav", "hello.wav" };
+
+		const double MinSeconds = 0.5;
+		const double VoiceBand = 3400;	//Hz, scoring low-pass
+		const long PicClock = 4000000;	//the Timer0 rate of cylon_sound.c
+		const long PicRateDen = 4L * 256 * 2;
+
+		private Benchmark() {}
+
+		/*
+		 * bool Run(string[], TextWriter)
+		 * Benchmarks each file and writes the results table.  Returns
+		 * false if any file could not be read.
+		 */
+		public static bool Run(string[] files, TextWriter results)
+		{
+			results.WriteLine("clip\tmode\trate\tin_bytes\tout_bytes\tmb_s\tpeak_kb\tseg_snr");
+			bool ok = true;
+			foreach (string file in files)
+			{
+				WaveFile clip;
+				byte[] raw;
+				using (WaveFileReader reader = new WaveFileReader(file))
+				{
+					clip = reader.ReadHeaders(file);
+					if (clip.data == null)
+					{
+						Console.WriteLine(file + ": no data chunk");
+						ok = false;
+						continue;
+					}
+					raw = reader.ReadData();
+				}
+
+				fmtChunk format = clip.format;
+				float[] source = new float[raw.Length / format.wBlockAlign];
+				Quantiser.Decode(raw, source.Length, format.wChannels, (int)format.dwBitsPerSample / 8, source);
+
+				foreach (QuantiseMode mode in new QuantiseMode[] { QuantiseMode.Threshold, QuantiseMode.SigmaDelta1, QuantiseMode.SigmaDelta2, QuantiseMode.Pcm, QuantiseMode.Adpcm })
+				{
+					for (int resample = 0; resample < 2; resample++)
+					{
+						QuantiseSettings settings = new QuantiseSettings();
+						settings.Mode = mode;
+						if (resample != 0)
+						{
+							settings.RateNum = PicClock;
+							settings.RateDen = PicRateDen;
+						}
+						results.WriteLine(measure(Path.GetFileName(file), format, raw, source, settings));
+						results.Flush();
+					}
+				}
+			}
+			return ok;
+		}
+
+		static string measure(string name, fmtChunk format, byte[] raw, float[] source, QuantiseSettings settings)
+		{
+			//Once untimed, to warm up and to keep for scoring.
+			MemoryStream packed = new MemoryStream();
+			new Quantiser(format, settings).Run(new MemoryStream(raw, false), raw.Length, packed, 1 << 16);
+
+			int runs = 0;
+			Stopwatch clock = Stopwatch.StartNew();
+			while (clock.Elapsed.TotalSeconds < MinSeconds)
+			{
+				new Quantiser(format, settings).Run(new MemoryStream(raw, false), raw.Length, new MemoryStream(), 1 << 16);
+				runs++;
+			}
+			clock.Stop();
+			double mbs = (double)raw.Length * runs / (1 << 20) / clock.Elapsed.TotalSeconds;
+			long peak = Process.GetCurrentProcess().PeakWorkingSet64 / 1024;
+
+			double rate = (settings.RateNum > 0) ? (double)settings.RateNum / settings.RateDen : (double)format.dwSamplesPerSec / settings.Window;
+			float[] y;
+			if (settings.Mode == QuantiseMode.Pcm)
+				y = Fidelity.ReconstructPcm(packed.ToArray(), settings.Bits, format.dwSamplesPerSec / rate, source.Length);
+			else if (settings.Mode == QuantiseMode.Adpcm)
+				y = Fidelity.ReconstructAdpcm(packed.ToArray(), format.dwSamplesPerSec / rate, source.Length);
+			else
+				y = Fidelity.Reconstruct(packed.ToArray(), format.dwSamplesPerSec / rate, source.Length);
+			double snr = Fidelity.SegmentalSnr(source, y, format.dwSamplesPerSec, VoiceBand);
+
+			CultureInfo c = CultureInfo.InvariantCulture;
+			return name + "\t" + settings.Mode + "\t" + rate.ToString("F3", c) + "\t" + raw.Length + "\t" + packed.Length
+				+ "\t" + mbs.ToString("F2", c) + "\t" + peak + "\t" + snr.ToString("F2", c);
+		}
+	}
+}
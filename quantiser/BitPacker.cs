@@ -0,0 +1,150 @@
+using System;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Decimate, threshold and pack kernels for the 1-bit sound tables.
+	/// </summary>
+	/*
+	 * Every output bit is the mean of one window of 8-bit samples compared
+	 * against the level, packed LSB first (the first window in bit 0) as
+	 * the firmware shifts s_mask up from 1.
+	 *
+	 * Pack() does eight windows at a time: the eight window sums sit in
+	 * 16-bit lanes of two ulongs, biased so a lane's top bit is set exactly
+	 * when the sum reaches the threshold, and one multiply per ulong gathers
+	 * those top bits into the output byte.  PackScalar() is the plain
+	 * bit-at-a-time loop it must agree with.
+	 */
+	public sealed class BitPacker
+	{
+		const ulong LaneOnes = 0x0001000100010001UL;
+		const ulong LaneTops = 0x8000800080008000UL;
+		const ulong GatherMul = 0x0000200040008001UL;	//1<<0 | 1<<15 | 1<<30 | 1<<45
+
+		private BitPacker() {}
+
+		/*
+		 * int Pack(...)
+		 * Packs windows*window samples from src into windows/8 bytes of dst,
+		 * windows must be a multiple of 8.  Returns the bytes written.
+		 */
+		public static int Pack(byte[] src, int offset, int windows, int window, int level, byte[] dst, int dstOffset)
+		{
+			//Lanes hold sum + 0x8000 - threshold, which must stay inside 16 bits.
+			if (window > 128 || level < 0 || level > 255)
+				return PackScalar(src, offset, windows, window, level, dst, dstOffset);
+
+			ulong bias = (ulong)(0x8000 - window * (level + 1)) * LaneOnes;
+			int n = windows >> 3;
+			int p = offset;
+
+			for (int k = 0; k < n; k++)
+			{
+				ulong lo = 0, hi = 0;
+				for (int lane = 0; lane < 4; lane++)
+				{
+					lo |= (ulong)windowSum(src, p, window) << (lane << 4);
+					p += window;
+				}
+				for (int lane = 0; lane < 4; lane++)
+				{
+					hi |= (ulong)windowSum(src, p, window) << (lane << 4);
+					p += window;
+				}
+
+				lo = ((lo + bias) & LaneTops) >> 15;
+				hi = ((hi + bias) & LaneTops) >> 15;
+				dst[dstOffset + k] = (byte)(((lo * GatherMul) >> 45) & 0x0F | (((hi * GatherMul) >> 41) & 0xF0));
+			}
+			return n;
+		}
+
+		/*
+		 * int PackScalar(...)
+		 * Reference version of Pack(), one compare and one shift per bit.
+		 */
+		public static int PackScalar(byte[] src, int offset, int windows, int window, int level, byte[] dst, int dstOffset)
+		{
+			int n = windows >> 3;
+			int p = offset;
+
+			for (int k = 0; k < n; k++)
+			{
+				int bp = 1;
+				int bo = 0;
+				for (int b = 0; b < 8; b++)
+				{
+					if (windowSum(src, p, window) / window > level)
+						bo = bo | bp;
+					bp = bp << 1;
+					p += window;
+				}
+				dst[dstOffset + k] = (byte)bo;
+			}
+			return n;
+		}
+
+		static int windowSum(byte[] src, int p, int window)
+		{
+			int t = 0;
+			for (int s = 0; s < window; s++)
+				t += src[p + s];
+			return t;
+		}
+
+		/*
+		 * bool SelfTest()
+		 * Checks Pack() against PackScalar() over random blocks and levels,
+		 * and that the first window lands in bit 0.
+		 */
+		public static bool SelfTest()
+		{
+			Random rnd = new Random(627);
+			int window = 11;
+			byte[] src = new byte[window * 8 * 64];
+			byte[] a = new byte[src.Length / 8];
+			byte[] b = new byte[src.Length / 8];
+
+			//Only the first window high must give 0x01, only the last 0x80.
+			for (int i = 0; i < window; i++)
+				src[i] = 255;
+			Pack(src, 0, 8, window, 128, a, 0);
+			if (a[0] != 0x01)
+			{
+				Console.WriteLine("BitPacker: first window packed to " + a[0] + ", expected 1");
+				return false;
+			}
+			Array.Clear(src, 0, src.Length);
+			for (int i = 7 * window; i < 8 * window; i++)
+				src[i] = 255;
+			Pack(src, 0, 8, window, 128, a, 0);
+			if (a[0] != 0x80)
+			{
+				Console.WriteLine("BitPacker: last window packed to " + a[0] + ", expected 128");
+				return false;
+			}
+
+			for (int pass = 0; pass < 200; pass++)
+			{
+				rnd.NextBytes(src);
+				int level = (pass < 3) ? pass * 127 + (pass >> 1) : rnd.Next(256);	//0, 127, 255, then random
+				window = 1 + rnd.Next(32);
+				int windows = (src.Length / window) & ~7;
+
+				int na = Pack(src, 0, windows, window, level, a, 0);
+				int nb = PackScalar(src, 0, windows, window, level, b, 0);
+				for (int i = 0; i < nb; i++)
+				{
+					if (na != nb || a[i] != b[i])
+					{
+						Console.WriteLine("BitPacker: mismatch at byte " + i + " window " + window + " level " + level);
+						return false;
+					}
+				}
+			}
+			Console.WriteLine("BitPacker: ok");
+			return true;
+		}
+	}
+}
@@ -1,6 +1,8 @@
 using System;
 using System.IO;
 using System.Runtime.InteropServices;
+using System.Collections.Generic;
+using System.Globalization;
 
 using System.Xml.Serialization;
 
@@ -15,61 +17,396 @@ namespace KadeSoft
 	 */
 	static void Main(string[] args)
 	{ 
-        args = new string[2];
+        //  WaveEdit [options] [file.wav [file.xml]]
+        //  WaveEdit [options] -hex out.hex [-org WORD] | -eeprom out.hex file.wav
+        //  WaveEdit [options] -bank sounds.h [-flash sounds.bin] a.wav b.wav ...
+        //  WaveEdit [options] -stream [-raw RATE BITS CHANNELS] < pcm > bits
+        //  WaveEdit -tune BYTES file.wav
+        //  WaveEdit -bench results.tsv [a.wav b.wav ...]
+        //  WaveEdit [-pic PIC_CLK PS] -melody tune.h file.wav
+        //  WaveEdit -patch in.hex in.map tables.h out.hex
+        //  WaveEdit [-pic PIC_CLK PS] -rtttl song.txt tune.h
+        //  WaveEdit -gamma GAMMA gamma.h
+        //  WaveEdit -selftest
+        //
+        //  -sd1 / -sd2         sigma-delta encoder instead of the threshold
+        //  -pcm BITS           4..8 bit PCM for ccp_pcm.c (defines SOUND_PCM)
+        //  -adpcm              4-bit IMA ADPCM for ccp_pcm.c (defines SOUND_ADPCM)
+        //  -rate Hz            resample to one bit per ISR tick at this rate
+        //  -pic PIC_CLK PS     the same, as the Timer0 rate for this clock and
+        //                      PS2:PS0 prescaler (-pic 4000000 0 = 1953.125 Hz)
+        //  -level N            threshold (or sigma-delta mid-scale), default 128
+        //  -window N           samples averaged per bit when not resampling, 11
+        //  -lz                 compress for the ISR decoder (defines SOUND_LZ)
+        //
+        //  -hex writes the clip as a RETLW table at program word WORD (hex,
+        //  default the top of memory) and -eeprom as data EEPROM at 0x2100,
+        //  both as Intel HEX for the programmer instead of test.bin.
+        //
+        //  -tune searches mode, window and level for the best segmental SNR
+        //  that fits in BYTES and prints the size/quality trade-offs it finds.
+        //  -bench times and scores every mode over the clips (eye.wav and
+        //  hello.wav by default) and writes a table to compare between builds.
+        //  -melody pitch-tracks a one-voice clip into a tune[] for the DDS tone
+        //  engine, timed in Timer0 ticks (4MHz, PS 0 unless -pic says otherwise).
+        //  -patch rewrites each const table in tables.h (as the options above
+        //  write them) in a built image, found by name in the gplink map.
+        //  -rtttl compiles an RTTTL tune to the packed tune[] and note_inc[]
+        //  of the cylon_plus.c player for that clock and prescaler.
+        //  -gamma writes the level-to-BAM-duty table the cylon_plus.c
+        //  crossfade uses, for a display gamma such as 2.2.
+        //
+        //  -flash puts the bank's clips in a binary image for a 25-series SPI
+        //  flash (ccp_pcm.c streams them) and leaves only the index in the header.
+        //
+        //  -stream reads WAV (or with -raw, headerless PCM) from standard input
+        //  and writes the packed bits to standard output as they are made.
+        QuantiseSettings settings = new QuantiseSettings();
+        bool lz = false;
+        bool stream = false;
+        fmtChunk raw = null;
+        string bank = null;
+        string flash = null;
+        int budget = 0;
+        string bench = null;
+        string hex = null, eeprom = null;
+        string melody = null;
+        string[] patch = null;
+        string[] rtttl = null;
+        string[] gamma = null;
+        int org = -1;
+        List<string> files = new List<string>();
 
-        args[0] = "test.wav";
-        args[1] = "test.xml";
+        for (int i = 0; i < args.Length; i++)
+        {
+            if (args[i] == "-selftest")
+            {
+                //checks the packing kernels and the compressor
+                bool ok = BitPacker.SelfTest();
+                ok = SoundCompressor.SelfTest() && ok;
+                Environment.ExitCode = ok ? 0 : 1;
+                return;
+            }
+            else if (args[i] == "-sd1")
+                settings.Mode = QuantiseMode.SigmaDelta1;
+            else if (args[i] == "-sd2")
+                settings.Mode = QuantiseMode.SigmaDelta2;
+            else if (args[i] == "-pcm" && i + 1 < args.Length)
+            {
+                settings.Mode = QuantiseMode.Pcm;
+                settings.Bits = int.Parse(args[++i]);
+            }
+            else if (args[i] == "-adpcm")
+                settings.Mode = QuantiseMode.Adpcm;
+            else if (args[i] == "-lz")
+                lz = true;
+            else if (args[i] == "-stream")
+                stream = true;
+            else if (args[i] == "-raw" && i + 3 < args.Length)
+            {
+                raw = new fmtChunk();
+                raw.sChunkID = "fmt ";
+                raw.wFormatTag = 1;
+                raw.dwSamplesPerSec = uint.Parse(args[++i]);
+                raw.dwBitsPerSample = uint.Parse(args[++i]);
+                raw.wChannels = ushort.Parse(args[++i]);
+                raw.wBlockAlign = (ushort)(raw.dwBitsPerSample / 8 * raw.wChannels);
+                raw.dwAvgBytesPerSec = raw.dwSamplesPerSec * raw.wBlockAlign;
+            }
+            else if (args[i] == "-rate" && i + 1 < args.Length)
+            {
+                settings.RateDen = 1000;
+                settings.RateNum = (long)Math.Round(double.Parse(args[++i], CultureInfo.InvariantCulture) * settings.RateDen);
+            }
+            else if (args[i] == "-pic" && i + 2 < args.Length)
+            {
+                //Timer0 overflows every 256 * 2^(PS+1) instruction cycles of PIC_CLK/4.
+                settings.RateNum = long.Parse(args[++i]);
+                settings.RateDen = 4L * 256 << (int.Parse(args[++i]) + 1);
+            }
+            else if (args[i] == "-level" && i + 1 < args.Length)
+                settings.Level = int.Parse(args[++i]);
+            else if (args[i] == "-window" && i + 1 < args.Length)
+                settings.Window = int.Parse(args[++i]);
+            else if (args[i] == "-bank" && i + 1 < args.Length)
+                bank = args[++i];
+            else if (args[i] == "-flash" && i + 1 < args.Length)
+                flash = args[++i];
+            else if (args[i] == "-tune" && i + 1 < args.Length)
+                budget = int.Parse(args[++i]);
+            else if (args[i] == "-bench" && i + 1 < args.Length)
+                bench = args[++i];
+            else if (args[i] == "-hex" && i + 1 < args.Length)
+                hex = args[++i];
+            else if (args[i] == "-eeprom" && i + 1 < args.Length)
+                eeprom = args[++i];
+            else if (args[i] == "-patch" && i + 4 < args.Length)
+            {
+                patch = new string[] { args[i + 1], args[i + 2], args[i + 3], args[i + 4] };
+                i += 4;
+            }
+            else if (args[i] == "-rtttl" && i + 2 < args.Length)
+            {
+                rtttl = new string[] { args[i + 1], args[i + 2] };
+                i += 2;
+            }
+            else if (args[i] == "-gamma" && i + 2 < args.Length)
+            {
+                gamma = new string[] { args[i + 1], args[i + 2] };
+                i += 2;
+            }
+            else if (args[i] == "-melody" && i + 1 < args.Length)
+                melody = args[++i];
+            else if (args[i] == "-org" && i + 1 < args.Length)
+                org = int.Parse(args[++i], NumberStyles.HexNumber);
+            else
+                files.Add(args[i]);
+        }
+
+        if (stream)
+        {
+            //Live: nothing but packed bits may go to standard output.
+            Stream input = Console.OpenStandardInput();
+            Stream output = Console.OpenStandardOutput();
+            try
+            {
+                fmtChunk format = raw;
+                long length = long.MaxValue;
+                if (format == null)
+                {
+                    WaveFile header = new WaveFileReader(input).ReadToData("stdin");
+                    format = header.format;
+                    length = header.data.dwChunkSize;
+                }
+                new Quantiser(format, settings).Run(input, length, output, StreamBlockSize);
+            }
+            catch (Exception e)
+            {
+                Console.Error.WriteLine(e.Message);
+                Environment.ExitCode = 1;
+            }
+            output.Close();
+            return;
+        }
+
+        if (bank != null)
+        {
+            //Many clips into one header, quantised in parallel.
+            SoundBank sounds = new SoundBank(files.ToArray(), settings);
+            sounds.Compress = lz;
+            if (!sounds.Build())
+            {
+                Environment.ExitCode = 1;
+                return;
+            }
+            StreamWriter h = new StreamWriter(bank);
+            if (flash == null)
+                sounds.Write(h);
+            else
+            {
+                FileStream image = new FileStream(flash, FileMode.Create);
+                sounds.WriteFlash(h, image, flash);
+                Console.WriteLine(flash + ": " + image.Length + " bytes");
+                image.Close();
+            }
+            h.Close();
+            Console.WriteLine(bank + ": " + files.Count + " sounds");
+            return;
+        }
+
+        if (rtttl != null)
+        {
+            double tick = (settings.RateNum > 0) ? (double)settings.RateNum / settings.RateDen : 4000000.0 / (4 * 256 * 2);
+            try
+            {
+                TuneCompiler compiler = new TuneCompiler(tick);
+                using (StreamReader song = new StreamReader(rtttl[0]))
+                    compiler.Compile(song.ReadToEnd());
+                StreamWriter h = new StreamWriter(rtttl[1]);
+                compiler.Write(h, rtttl[0]);
+                h.Close();
+                Console.WriteLine(rtttl[1] + ": written");
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine(rtttl[0] + ": " + e.Message);
+                Environment.ExitCode = 1;
+            }
+            return;
+        }
+
+        if (gamma != null)
+        {
+            try
+            {
+                GammaTable table = new GammaTable(double.Parse(gamma[0], CultureInfo.InvariantCulture), GammaFadeSteps, GammaBamBits);
+                StreamWriter h = new StreamWriter(gamma[1]);
+                table.Write(h);
+                h.Close();
+                Console.WriteLine(gamma[1] + ": written");
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine(gamma[0] + ": " + e.Message);
+                Environment.ExitCode = 1;
+            }
+            return;
+        }
+
+        if (patch != null)
+        {
+            //Content into a built image without the PIC toolchain.
+            try
+            {
+                HexPatcher patcher = new HexPatcher(patch[0], patch[1]);
+                Dictionary<string, byte[]> tables;
+                using (StreamReader h = new StreamReader(patch[2]))
+                    tables = HexPatcher.ReadTables(h);
+                if (tables.Count == 0)
+                    throw new FormatException(patch[2] + ": no unsigned char, int or long tables");
+                foreach (KeyValuePair<string, byte[]> table in tables)
+                    Console.WriteLine(patcher.Patch(table.Key, table.Value));
+                patcher.Save(patch[3]);
+                Console.WriteLine(patch[3] + ": " + tables.Count + " tables patched");
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine(e.Message);
+                Environment.ExitCode = 1;
+            }
+            return;
+        }
+
+        if (bench != null)
+        {
+            if (files.Count < 1)
+                files.AddRange(Benchmark.Corpus);
+            StreamWriter results = new StreamWriter(bench);
+            if (!Benchmark.Run(files.ToArray(), results))
+                Environment.ExitCode = 1;
+            results.Close();
+            Console.WriteLine(bench + ": " + files.Count + " clips");
+            return;
+        }
+
+        if (files.Count < 1)
+            files.Add("test.wav");
+
+        if (melody != null)
+        {
+            double tick = (settings.RateNum > 0) ? (double)settings.RateNum / settings.RateDen : 4000000.0 / (4 * 256 * 2);
+            using (WaveFileReader tuneReader = new WaveFileReader(files[0]))
+            {
+                WaveFile clip = tuneReader.ReadHeaders(files[0]);
+                if (clip.data == null)
+                {
+                    Console.WriteLine(files[0] + ": no data chunk");
+                    Environment.ExitCode = 1;
+                    return;
+                }
+                MelodyExtractor extractor = new MelodyExtractor(tuneReader, clip.format, tick);
+                List<MelodyExtractor.Note> notes = extractor.Extract();
+                StreamWriter h = new StreamWriter(melody);
+                extractor.WriteTune(h, "tune", notes);
+                h.Close();
+                Console.WriteLine(melody + ": " + notes.Count + " notes, " + MelodyExtractor.Chords(notes).Length + " bytes");
+            }
+            return;
+        }
+
+        if (budget > 0)
+        {
+            //Rate-distortion search over one clip; nothing is written.
+            using (WaveFileReader tuneReader = new WaveFileReader(files[0]))
+            {
+                WaveFile clip = tuneReader.ReadHeaders(files[0]);
+                if (clip.data == null)
+                {
+                    Console.WriteLine(files[0] + ": no data chunk");
+                    Environment.ExitCode = 1;
+                    return;
+                }
+                AutoTuner tuner = new AutoTuner(tuneReader, clip.format, budget);
+                tuner.Run();
+                tuner.Report(Console.Out);
+            }
+            return;
+        }
+
+        if (files.Count < 2)
+            files.Add("test.xml");
 
 		//We'll use the XmlSerializer class, eventually, to create an XML filedump of 
 		//the wave file information.
 		XmlSerializer xmlout = new XmlSerializer(typeof(WaveFile));
-		Stream writer = new FileStream(args[1], FileMode.Create);
-		string temp;
+		Stream writer = new FileStream(files[1], FileMode.Create);
 
 		//We use a custom filereader called WaveFileReader to retrieve the data from the
 		//wave files.  In addition to conforming to good coding conventions, this streamlines
 		//the code: here we just look at the "big picture", while in the WaveFileReader class
 		//we only care what's going on in one small place at a time.
-		WaveFileReader reader = new WaveFileReader(args[0]);
-		WaveFile contents = new WaveFile();
-		contents.maindata = reader.ReadMainFileHeader(); 
-		contents.maindata.FileName = args[0];
-		while (reader.GetPosition() < (long) contents.maindata.dwFileLength)
+		WaveFileReader reader = new WaveFileReader(files[0]);
+		WaveFile contents = reader.ReadHeaders(files[0]);
+
+		if (contents.data != null)
 		{
-			temp = reader.GetChunkName();
-			if (temp=="fmt ")
-			{
-				contents.format = reader.ReadFormatHeader();
-				if (reader.GetPosition()+contents.format.dwChunkSize == contents.maindata.dwFileLength)
-					break;
-			}
-			else if (temp=="fact")
-			{
-				contents.fact = reader.ReadFactHeader();
-				if (reader.GetPosition()+contents.fact.dwChunkSize == contents.maindata.dwFileLength)
-					break;
-			}
-			else if (temp=="data")
-			{
-				contents.data = reader.ReadDataHeader();
-				if (reader.GetPosition()+contents.data.dwChunkSize == contents.maindata.dwFileLength)
-					break;
-
-                //
-                Console.WriteLine("test-" + contents.data.dSecLength);
-                StreamWriter f = new StreamWriter("test.bin");
-                reader.quantise(f, 128);
-                f.Close();
-			}
-			else
-			{	//This provides the required skipping of unsupported chunks.
-				reader.AdvanceToNext();
-			}
+            Console.WriteLine("test-" + contents.data.dSecLength);
+            if (hex != null || eeprom != null)
+            {
+                //Straight to a programmer image, no firmware rebuild.
+                MemoryStream packed = new MemoryStream();
+                if (!reader.quantise(packed, settings))
+                    Environment.ExitCode = 1;
+                else
+                {
+                    byte[] bytes = lz ? SoundCompressor.Compress(packed.ToArray()) : packed.ToArray();
+                    try
+                    {
+                        StreamWriter h = new StreamWriter(hex != null ? hex : eeprom);
+                        if (hex != null)
+                            IntelHex.WriteRetlw(h, bytes, org);
+                        else
+                            IntelHex.WriteEeprom(h, bytes);
+                        h.Close();
+                        Console.WriteLine((hex != null ? hex : eeprom) + ": " + bytes.Length + " bytes");
+                    }
+                    catch (ArgumentOutOfRangeException e)
+                    {
+                        Console.WriteLine(e.Message);
+                        Environment.ExitCode = 1;
+                    }
+                }
+                xmlout.Serialize(writer, contents);
+                return;
+            }
+            StreamWriter f = new StreamWriter("test.bin");
+            if (settings.Mode == QuantiseMode.Pcm)
+                f.WriteLine("#define SOUND_PCM " + settings.Bits);
+            else if (settings.Mode == QuantiseMode.Adpcm)
+                f.WriteLine("#define SOUND_ADPCM 1");
+            if (!lz)
+                reader.quantise(f, settings);
+            else
+            {
+                MemoryStream packed = new MemoryStream();
+                reader.quantise(packed, settings);
+                byte[] bytes = SoundCompressor.Compress(packed.ToArray());
+                Console.WriteLine("lz: " + packed.Length + " -> " + bytes.Length + " bytes");
+                f.WriteLine("#define SOUND_LZ 1");
+                WaveFileReader.WriteTable(f, "sound", bytes, 0, bytes.Length);
+            }
+            f.Close();
 		}
 
 		xmlout.Serialize(writer, contents);
 		return;
 	    }
+
+    //Bytes read per step in -stream mode; at 22kHz 8-bit mono about 12ms.
+    const int StreamBlockSize = 256;
+    //The cylon_plus.c crossfade: steps per frame and BAM_BITS.
+    const int GammaFadeSteps = 4;
+    const int GammaBamBits = 4;
   }
 
   public class WaveFile
@@ -0,0 +1,176 @@
+using System;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Plays a packed 1-bit stream back to PCM and scores it against the source.
+	/// </summary>
+	/*
+	 * Reconstruct() holds each bit as +1 or -1 for as many source samples
+	 * as it stood for, like the piezo being driven one way or the other
+	 * for a tick; ReconstructPcm() and ReconstructAdpcm() do the same with
+	 * the duty cycle of each PcmPacker or ImaAdpcm code.  SegmentalSnr() then low-pass filters both signals to
+	 * the voice band the piezo and the ear care about, fits the one gain
+	 * and offset that best match them, and averages the SNR of 20ms
+	 * segments, skipping ones more than 40dB below the loudest.
+	 */
+	public sealed class Fidelity
+	{
+		const double SegmentSeconds = 0.02;
+		const double MinSnr = -10, MaxSnr = 35;		//usual segmental SNR clamps, dB
+		const double SilenceDb = 40;
+
+		private Fidelity() {}
+
+		/*
+		 * float[] Reconstruct(byte[], double, int)
+		 * Expands bits (LSB first) to length samples at the source rate,
+		 * samplesPerBit source samples to each bit.
+		 */
+		public static float[] Reconstruct(byte[] bits, double samplesPerBit, int length)
+		{
+			float[] y = new float[length];
+			long nbits = (long)bits.Length * 8;
+			for (int i = 0; i < length; i++)
+			{
+				long b = (long)(i / samplesPerBit);
+				if (b >= nbits)
+					b = nbits - 1;
+				y[i] = (b >= 0 && ((bits[b >> 3] >> (int)(b & 7)) & 1) != 0) ? 1f : -1f;
+			}
+			return y;
+		}
+
+		/*
+		 * float[] ReconstructPcm(byte[], int, double, int)
+		 * Expands bits wide codes (as PcmPacker packs them) to length
+		 * samples in -1..1, samplesPerCode source samples to each.
+		 */
+		public static float[] ReconstructPcm(byte[] packed, int bits, double samplesPerCode, int length)
+		{
+			PcmPacker pcm = new PcmPacker(bits);
+			float[] y = new float[length];
+			long ncodes = (long)packed.Length * 8 / bits;
+			for (int i = 0; i < length; i++)
+			{
+				long c = (long)(i / samplesPerCode);
+				if (c >= ncodes)
+					c = ncodes - 1;
+				int code = 0;
+				for (int b = 0; c >= 0 && b < bits; b++)
+				{
+					long bit = c * bits + b;
+					code |= ((packed[bit >> 3] >> (int)(bit & 7)) & 1) << b;
+				}
+				y[i] = (pcm.Level(code) - 128) / 128f;
+			}
+			return y;
+		}
+
+		/*
+		 * float[] ReconstructAdpcm(byte[], double, int)
+		 * Decodes ImaAdpcm codes to length samples in -1..1 through the
+		 * player's 8-bit duty, samplesPerCode source samples to each.
+		 */
+		public static float[] ReconstructAdpcm(byte[] packed, double samplesPerCode, int length)
+		{
+			ImaAdpcm decoder = new ImaAdpcm();
+			float[] y = new float[length];
+			long ncodes = (long)packed.Length * 2;
+			long decoded = 0;
+			float level = 0;
+			for (int i = 0; i < length; i++)
+			{
+				long c = (long)(i / samplesPerCode);
+				if (c >= ncodes)
+					c = ncodes - 1;
+				while (decoded <= c)
+				{
+					int code = (packed[decoded >> 1] >> (int)((decoded & 1) * 4)) & 15;
+					level = (ImaAdpcm.Level(decoder.Decode(code)) - 128) / 128f;
+					decoded++;
+				}
+				y[i] = level;
+			}
+			return y;
+		}
+
+		/*
+		 * double SegmentalSnr(float[], float[], uint, double)
+		 * Scores test against reference, both at sampleRate, through a
+		 * low-pass at cutoff Hz.  Higher is better.
+		 */
+		public static double SegmentalSnr(float[] reference, float[] test, uint sampleRate, double cutoff)
+		{
+			int n = Math.Min(reference.Length, test.Length);
+			if (n == 0)
+				return MinSnr;
+			double[] r = lowPass(reference, n, sampleRate, cutoff);
+			double[] y = lowPass(test, n, sampleRate, cutoff);
+
+			//Least squares gain and offset of y onto r.
+			double mr = 0, my = 0;
+			for (int i = 0; i < n; i++)
+			{
+				mr += r[i];
+				my += y[i];
+			}
+			mr /= n;
+			my /= n;
+			double ry = 0, yy = 0;
+			for (int i = 0; i < n; i++)
+			{
+				ry += (r[i] - mr) * (y[i] - my);
+				yy += (y[i] - my) * (y[i] - my);
+			}
+			double g = (yy > 0) ? ry / yy : 0;
+
+			int seg = Math.Max(1, (int)(sampleRate * SegmentSeconds));
+			int segs = (n + seg - 1) / seg;
+			double[] sig = new double[segs];
+			double[] err = new double[segs];
+			double loudest = 0;
+			for (int i = 0; i < n; i++)
+			{
+				double a = r[i] - mr;
+				double e = a - g * (y[i] - my);
+				sig[i / seg] += a * a;
+				err[i / seg] += e * e;
+			}
+			for (int k = 0; k < segs; k++)
+				loudest = Math.Max(loudest, sig[k]);
+
+			double sum = 0;
+			int used = 0;
+			for (int k = 0; k < segs; k++)
+			{
+				if (sig[k] <= 0 || sig[k] < loudest * Math.Pow(10, -SilenceDb / 10))
+					continue;
+				double snr = (err[k] > 0) ? 10 * Math.Log10(sig[k] / err[k]) : MaxSnr;
+				sum += Math.Max(MinSnr, Math.Min(MaxSnr, snr));
+				used++;
+			}
+			return (used > 0) ? sum / used : MinSnr;
+		}
+
+		//Two cascaded one-pole low-passes, run forwards and backwards so
+		//there is no phase lag between the signals being compared.
+		static double[] lowPass(float[] x, int n, uint sampleRate, double cutoff)
+		{
+			double a = 1 - Math.Exp(-2 * Math.PI * Math.Min(cutoff, sampleRate / 2.0) / sampleRate);
+			double[] y = new double[n];
+			for (int i = 0; i < n; i++)
+				y[i] = x[i];
+			for (int pass = 0; pass < 2; pass++)
+			{
+				double s = y[0];
+				for (int i = 0; i < n; i++)
+					y[i] = s += a * (y[i] - s);
+				s = y[n - 1];
+				for (int i = n - 1; i >= 0; i--)
+					y[i] = s += a * (y[i] - s);
+			}
+			return y;
+		}
+	}
+}
@@ -0,0 +1,75 @@
+using System;
+using System.IO;
+using System.Text;
+using System.Globalization;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Writes the gamma lookup table the cylon_plus.c crossfade turns pattern levels into BAM duty with.
+	/// </summary>
+	/*
+	 * Pattern levels are perceived brightness, 0..15.  The crossfade
+	 * works between two frames in FADE_STEPS steps, so its values are
+	 * level * FADE_STEPS, 0..60 for 4 steps, and gamma_lut[] maps each to
+	 * the BAM duty (0..2^bits-1 ticks per cycle) that looks that bright:
+	 *
+	 *   duty = ceil(top * (v / vmax) ^ gamma)
+	 *
+	 * Rounded up, so anything lit stays lit: 4 bits of BAM cannot show the
+	 * bottom of a 2.2 curve, and a dim tail that rounds to 0 would vanish.
+	 */
+	public class GammaTable
+	{
+		public const int Levels = 15;		//top pattern level, 4 bits
+
+		double gamma;
+		int steps;
+		int top;
+		int[] table;
+
+		public GammaTable(double gamma, int steps, int bits)
+		{
+			if (gamma <= 0)
+				throw new ArgumentOutOfRangeException("gamma", "gamma must be above 0");
+			if (steps < 1 || steps > 255 / Levels)
+				throw new ArgumentOutOfRangeException("steps", "1.." + (255 / Levels) + " fade steps");
+			this.gamma = gamma;
+			this.steps = steps;
+			top = (1 << bits) - 1;
+
+			int vmax = Levels * steps;
+			table = new int[vmax + 1];
+			for (int v = 0; v <= vmax; v++)
+				table[v] = (int)Math.Ceiling(top * Math.Pow((double)v / vmax, gamma) - 1e-9);
+		}
+
+		/*
+		 * void Write(TextWriter)
+		 * Writes FADE_STEPS and gamma_lut[] as a header for the firmware.
+		 */
+		public void Write(TextWriter outfile)
+		{
+			CultureInfo c = CultureInfo.InvariantCulture;
+
+			outfile.WriteLine("/* Gamma " + gamma.ToString("F2", c) + " table written by WaveEdit -gamma, do not edit. */");
+			outfile.WriteLine("");
+			outfile.WriteLine("// Crossfade steps per frame; gamma_lut[] has " + Levels + " * FADE_STEPS + 1 entries");
+			outfile.WriteLine("#define FADE_STEPS\t" + steps);
+			outfile.WriteLine("");
+			outfile.WriteLine("// BAM duty 0.." + top + " for each level * FADE_STEPS + step, ceil(" + top + " * (v / " + (table.Length - 1) + ") ^ " + gamma.ToString("F2", c) + ")");
+			outfile.WriteLine("const unsigned char gamma_lut[] = {");
+			StringBuilder line = new StringBuilder("\t");
+			for (int v = 0; v < table.Length; v++)
+			{
+				line.Append(table[v]).Append(',');
+				if (v % steps == steps - 1 || v == table.Length - 1)
+				{
+					outfile.WriteLine(line.ToString() + "\t// " + (v / steps));
+					line = new StringBuilder("\t");
+				}
+			}
+			outfile.WriteLine("\t};");
+		}
+	}
+}
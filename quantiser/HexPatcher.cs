@@ -0,0 +1,187 @@
+using System;
+using System.IO;
+using System.Text.RegularExpressions;
+using System.Globalization;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Rewrites const tables inside a built firmware .hex, found by symbol in the gplink map.
+	/// </summary>
+	/*
+	 * sdcc puts a const unsigned char table in program memory as one
+	 * RETLW k (0x34kk) per byte under the table's label, and an unsigned
+	 * int or long table the same way a byte at a time, low byte first, so
+	 * sound_index[] and note_inc[] patch like sound_bank[].  gplink -m (as
+	 * the Makefile runs it) lists each label's word address:
+	 *
+	 *   _tune    0x0001a3    program    static    cylon_plus.asm
+	 *
+	 * A table is the run of RETLW words from its label up to the next
+	 * program label.  New contents must fit in that run; a shorter table
+	 * is padded with RETLW 0, and as the firmware's sizeof() was fixed
+	 * when it was compiled that is only safe for tables with a terminator,
+	 * like tune[].  Tables in RAM (not const) are copied from sdcc's cinit
+	 * data at start up and cannot be patched this way.
+	 *
+	 * Function-local tables get names like _main_cylon_bits_a_1_1; a
+	 * table name matches those too if only one does.  The .cod file has
+	 * the same symbols but is not read.
+	 */
+	public class HexPatcher
+	{
+		struct Symbol
+		{
+			public int Address;		//words for program, bytes for data
+			public bool Program;
+		}
+
+		const int Retlw = 0x3400;
+
+		SortedList<int, byte> image;
+		Dictionary<string, Symbol> symbols = new Dictionary<string, Symbol>();
+		List<int> labels = new List<int>();	//program label addresses, sorted
+
+		public HexPatcher(string hexFile, string mapFile)
+		{
+			using (StreamReader hex = new StreamReader(hexFile))
+				image = IntelHex.Read(hex);
+
+			Regex line = new Regex(@"^\s*(\S+)\s+0x([0-9a-fA-F]+)\s+(program|data)\s");
+			using (StreamReader map = new StreamReader(mapFile))
+			{
+				string s;
+				while ((s = map.ReadLine()) != null)
+				{
+					Match m = line.Match(s);
+					if (!m.Success)
+						continue;
+					Symbol sym;
+					sym.Address = int.Parse(m.Groups[2].Value, NumberStyles.HexNumber);
+					sym.Program = m.Groups[3].Value == "program";
+					symbols[m.Groups[1].Value] = sym;
+					if (sym.Program)
+						labels.Add(sym.Address);
+				}
+			}
+			labels.Sort();
+			if (symbols.Count == 0)
+				throw new FormatException(mapFile + ": no symbols; is it a gplink -m map?");
+		}
+
+		/*
+		 * string Patch(string, byte[])
+		 * Rewrites table name with data.  Returns what was done, for the
+		 * console; throws ArgumentException if the table is missing, not a
+		 * RETLW table, or too small.
+		 */
+		public string Patch(string name, byte[] data)
+		{
+			string found = find(name);
+			Symbol sym = symbols[found];
+			if (!sym.Program)
+				throw new ArgumentException(name + ": " + found + " is in RAM; only const tables can be patched");
+
+			int next = labels.BinarySearch(sym.Address + 1);
+			int limit = (next >= 0) ? labels[next] : ((~next < labels.Count) ? labels[~next] : int.MaxValue);
+			int size = 0;
+			while (sym.Address + size < limit && isRetlw(sym.Address + size))
+				size++;
+			if (size == 0)
+				throw new ArgumentException(name + ": " + found + " at 0x" + sym.Address.ToString("X4") + " is not a RETLW table");
+			if (data.Length > size)
+				throw new ArgumentException(name + ": " + data.Length + " bytes do not fit in the " + size + " byte table at 0x" + sym.Address.ToString("X4"));
+
+			for (int i = 0; i < size; i++)
+			{
+				int w = Retlw | ((i < data.Length) ? data[i] : 0);
+				image[(sym.Address + i) * 2] = (byte)w;
+				image[(sym.Address + i) * 2 + 1] = (byte)(w >> 8);
+			}
+			string done = name + ": " + data.Length + " of " + size + " bytes at 0x" + sym.Address.ToString("X4");
+			if (data.Length < size)
+				done += ", padded with 0 (sizeof() in the firmware is still " + size + ")";
+			return done;
+		}
+
+		bool isRetlw(int word)
+		{
+			byte lo, hi;
+			if (!image.TryGetValue(word * 2, out lo) || !image.TryGetValue(word * 2 + 1, out hi))
+				return false;
+			return (((hi << 8) | lo) & 0x3F00) == Retlw;
+		}
+
+		//The map symbol for a C name: _name, or one _func_name_n_n.
+		string find(string name)
+		{
+			if (symbols.ContainsKey("_" + name))
+				return "_" + name;
+			if (symbols.ContainsKey(name))
+				return name;
+			Regex local = new Regex("^_[A-Za-z0-9_]+_" + Regex.Escape(name) + @"_\d+_\d+$");
+			string found = null;
+			foreach (string s in symbols.Keys)
+			{
+				if (local.IsMatch(s))
+				{
+					if (found != null)
+						throw new ArgumentException(name + ": both " + found + " and " + s + " match");
+					found = s;
+				}
+			}
+			if (found == null)
+				throw new ArgumentException(name + ": no such symbol in the map");
+			return found;
+		}
+
+		/*
+		 * void Save(string)
+		 * Writes the patched image.
+		 */
+		public void Save(string hexFile)
+		{
+			using (StreamWriter hex = new StreamWriter(hexFile))
+				IntelHex.Write(hex, image);
+		}
+
+		/*
+		 * Dictionary<string, byte[]> ReadTables(TextReader)
+		 * The unsigned char, int and long array initializers in C source,
+		 * as WaveEdit writes them (test.bin, -melody, -bank, -rtttl):
+		 * name[] = { 1,0x2,... };  Each comes back as the bytes sdcc lays
+		 * out, ints and longs low byte first.  Throws FormatException for
+		 * any other array initializer, so a header is never half patched.
+		 */
+		public static Dictionary<string, byte[]> ReadTables(TextReader source)
+		{
+			Dictionary<string, byte[]> tables = new Dictionary<string, byte[]>();
+			string text = Regex.Replace(source.ReadToEnd(), @"//[^\n]*|/\*.*?\*/", " ", RegexOptions.Singleline);
+			foreach (Match m in Regex.Matches(text, @"(\w+)\s*\[\s*\d*\s*\]\s*=\s*\{([^}]*)\}"))
+			{
+				string name = m.Groups[1].Value;
+				Match type = Regex.Match(text.Substring(0, m.Index), @"unsigned\s+(char|int|long)\s+$");
+				if (!type.Success)
+					throw new FormatException(name + "[]: only unsigned char, int and long tables can be patched");
+				int size = (type.Groups[1].Value == "char") ? 1 : (type.Groups[1].Value == "int") ? 2 : 4;
+				long top = (1L << (8 * size)) - 1;
+
+				List<byte> bytes = new List<byte>();
+				foreach (string v in m.Groups[2].Value.Split(','))
+				{
+					string t = v.Trim().TrimEnd('u', 'U', 'l', 'L');
+					if (t.Length == 0)
+						continue;
+					long x = t.StartsWith("0x") || t.StartsWith("0X") ? long.Parse(t.Substring(2), NumberStyles.HexNumber) : long.Parse(t);
+					if (x < 0 || x > top)
+						throw new FormatException(name + ": " + v.Trim() + " is not an unsigned " + type.Groups[1].Value);
+					for (int b = 0; b < size; b++)
+						bytes.Add((byte)(x >> (8 * b)));
+				}
+				tables[name] = bytes.ToArray();
+			}
+			return tables;
+		}
+	}
+}
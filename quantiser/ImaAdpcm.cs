@@ -0,0 +1,142 @@
+using System;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// IMA ADPCM encoder (and reference decoder) for the ccp_pcm.c player, 4 bits per sample.
+	/// </summary>
+	/*
+	 * Standard IMA/DVI ADPCM: each 4-bit code is a sign and three
+	 * magnitude bits of the difference from the predicted sample, in units
+	 * of a step size that grows after large codes and shrinks after small
+	 * ones (StepSizes, 89 entries from 7 to 32767).  The decoder adds
+	 *
+	 *   step/8 + (b2 ? step : 0) + (b1 ? step/2 : 0) + (b0 ? step/4 : 0)
+	 *
+	 * to the predictor, or takes it off if b3 is set, so it needs shifts
+	 * and adds only.
+	 *
+	 * There are no block headers: every clip starts with predictor 0 (the
+	 * mid level) and step index 0, as play_sound() sets them.  Samples are
+	 * the 8-bit window means scaled to 16 bits, and the player takes the
+	 * predictor's top byte as its duty.  Codes are packed two to a byte,
+	 * the first in the low nibble, as PcmPacker packs 4-bit PCM and as WAV
+	 * files hold IMA data.
+	 *
+	 * The encoder chooses each code by running the decoder, so it tracks
+	 * exactly what the PIC will play and the error cannot build up.
+	 */
+	public class ImaAdpcm
+	{
+		public static readonly int[] StepSizes = {
+			7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+			19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+			50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+			130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+			337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+			876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+			2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+			5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+			15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+			};
+		static readonly int[] indexStep = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+		int predictor;		//-32768..32767
+		int index;			//into StepSizes
+
+		/*
+		 * int Next(int)
+		 * Encodes one 8-bit (window mean) sample, returns the code.
+		 */
+		public int Next(int sample)
+		{
+			int step = StepSizes[index];
+			int diff = ((sample - 128) << 8) - predictor;
+			int code = 0;
+			if (diff < 0)
+			{
+				code = 8;
+				diff = -diff;
+			}
+			//The magnitude bits, largest first, as the decoder will sum them.
+			if (diff >= step)
+			{
+				code |= 4;
+				diff -= step;
+			}
+			if (diff >= step >> 1)
+			{
+				code |= 2;
+				diff -= step >> 1;
+			}
+			if (diff >= step >> 2)
+				code |= 1;
+			Decode(code);
+			return code;
+		}
+
+		/*
+		 * int Decode(int)
+		 * Advances the state by one code, as the firmware does, and returns
+		 * the new predictor.
+		 */
+		public int Decode(int code)
+		{
+			int step = StepSizes[index];
+			int diff = step >> 3;
+			if ((code & 4) != 0)
+				diff += step;
+			if ((code & 2) != 0)
+				diff += step >> 1;
+			if ((code & 1) != 0)
+				diff += step >> 2;
+			predictor += ((code & 8) != 0) ? -diff : diff;
+			if (predictor > 32767)
+				predictor = 32767;
+			else if (predictor < -32768)
+				predictor = -32768;
+
+			index += indexStep[code & 7];
+			if (index < 0)
+				index = 0;
+			else if (index > StepSizes.Length - 1)
+				index = StepSizes.Length - 1;
+			return predictor;
+		}
+
+		/*
+		 * int Level(int)
+		 * The 8-bit duty the player outputs for a predictor.
+		 */
+		public static int Level(int predictor)
+		{
+			return (predictor + 32768) >> 8;
+		}
+
+		/*
+		 * int Pack(...)
+		 * Like SigmaDelta.Pack, but windows (a multiple of 8) means become
+		 * windows/2 bytes of codes in dst.
+		 */
+		public int Pack(byte[] src, int offset, int windows, int window, byte[] dst, int dstOffset)
+		{
+			int p = offset;
+			for (int k = 0; k < windows; k += 2)
+			{
+				int lo, hi;
+				int t = 0;
+				for (int s = 0; s < window; s++)
+					t += src[p + s];
+				p += window;
+				lo = Next(t / window);
+				t = 0;
+				for (int s = 0; s < window; s++)
+					t += src[p + s];
+				p += window;
+				hi = Next(t / window);
+				dst[dstOffset + (k >> 1)] = (byte)(lo | (hi << 4));
+			}
+			return windows >> 1;
+		}
+	}
+}
@@ -0,0 +1,176 @@
+using System;
+using System.IO;
+using System.Text;
+using System.Globalization;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Writes packed sound bytes as Intel HEX, ready for the PIC programmer without a rebuild.
+	/// </summary>
+	/*
+	 * PIC14 hex files hold 14-bit words, low byte first, at twice the word
+	 * address, the way gplink writes them.  Two images are made:
+	 *
+	 *   Retlw   one RETLW k (0x34kk) per byte at a program memory word
+	 *           address, by default the top of the 16F627's 1K words.
+	 *           Read byte i by loading PCLATH:PCL with org+i from a CALL;
+	 *           the word returns the byte in W.
+	 *   Eeprom  one byte per word at 0x2100, the data EEPROM that
+	 *           0009-eeprom.c writes and 0010-eeprom_rd.c reads at run
+	 *           time.  Only 128 bytes fit.
+	 *
+	 * Records carry 16 data bytes.  The text is built in a StringBuilder
+	 * and written in one go.  Read() and Write() take any image as a list
+	 * of byte address and value, for HexPatcher.
+	 */
+	public sealed class IntelHex
+	{
+		public const int ProgramWords = 0x400;	//16F627; the 628 has 0x800
+		public const int EepromOrg = 0x2100;	//word address of data EEPROM
+		public const int EepromBytes = 128;
+		const int Retlw = 0x3400;
+		const int RecordBytes = 16;
+
+		private IntelHex() {}
+
+		/*
+		 * void WriteRetlw(TextWriter, byte[], int)
+		 * Writes bytes as a RETLW table starting at word org, or at the top
+		 * of program memory if org is negative.
+		 */
+		public static void WriteRetlw(TextWriter outfile, byte[] bytes, int org)
+		{
+			if (org < 0)
+				org = ProgramWords - bytes.Length;
+			if (org < 0 || org + bytes.Length > ProgramWords)
+				throw new ArgumentOutOfRangeException("org", bytes.Length + " words at 0x" + org.ToString("X") + " do not fit in " + ProgramWords + " words of program memory");
+
+			int[] words = new int[bytes.Length];
+			for (int i = 0; i < bytes.Length; i++)
+				words[i] = Retlw | bytes[i];
+			Write(outfile, image(words, org));
+		}
+
+		/*
+		 * void WriteEeprom(TextWriter, byte[])
+		 * Writes bytes as the initial data EEPROM contents.
+		 */
+		public static void WriteEeprom(TextWriter outfile, byte[] bytes)
+		{
+			if (bytes.Length > EepromBytes)
+				throw new ArgumentOutOfRangeException("bytes", bytes.Length + " bytes do not fit in " + EepromBytes + " bytes of EEPROM");
+
+			int[] words = new int[bytes.Length];
+			for (int i = 0; i < bytes.Length; i++)
+				words[i] = bytes[i];
+			Write(outfile, image(words, EepromOrg));
+		}
+
+		//Words from word address org as a byte image.
+		static SortedList<int, byte> image(int[] words, int org)
+		{
+			SortedList<int, byte> image = new SortedList<int, byte>(words.Length * 2);
+			for (int i = 0; i < words.Length; i++)
+			{
+				image.Add((org + i) * 2, (byte)words[i]);
+				image.Add((org + i) * 2 + 1, (byte)(words[i] >> 8));
+			}
+			return image;
+		}
+
+		/*
+		 * void Write(TextWriter, SortedList<int, byte>)
+		 * Writes an image of byte address to value as data records, then
+		 * the end record.  Runs of addresses share records.
+		 */
+		public static void Write(TextWriter outfile, SortedList<int, byte> image)
+		{
+			StringBuilder hex = new StringBuilder();
+			IList<int> keys = image.Keys;
+			IList<byte> values = image.Values;
+			byte[] data = new byte[RecordBytes];
+			int upper = 0;
+			for (int p = 0; p < keys.Count; )
+			{
+				int address = keys[p];
+				if ((address >> 16) != upper)
+				{
+					upper = address >> 16;
+					record(hex, 0, 4, new byte[] { (byte)(upper >> 8), (byte)upper }, 0, 2);
+				}
+				//Records stop at a gap or the 64K boundary as well as every 16 bytes.
+				int n = 0;
+				while (n < RecordBytes && p + n < keys.Count && keys[p + n] == address + n && ((address + n) & 0xFFFF) >= (address & 0xFFFF))
+				{
+					data[n] = values[p + n];
+					n++;
+				}
+				record(hex, address & 0xFFFF, 0, data, 0, n);
+				p += n;
+			}
+			record(hex, 0, 1, data, 0, 0);
+			outfile.Write(hex.ToString());
+		}
+
+		/*
+		 * SortedList<int, byte> Read(TextReader)
+		 * Reads data records, with extended segment and linear addresses,
+		 * up to the end record.  Throws FormatException on a bad record.
+		 */
+		public static SortedList<int, byte> Read(TextReader infile)
+		{
+			SortedList<int, byte> image = new SortedList<int, byte>();
+			int upper = 0;
+			string line;
+			int number = 0;
+			while ((line = infile.ReadLine()) != null)
+			{
+				number++;
+				line = line.Trim();
+				if (line.Length == 0)
+					continue;
+				if (line[0] != ':' || line.Length < 11 || (line.Length & 1) == 0)
+					throw new FormatException("line " + number + ": not an Intel HEX record");
+
+				byte[] rec = new byte[(line.Length - 1) / 2];
+				int sum = 0;
+				for (int i = 0; i < rec.Length; i++)
+				{
+					rec[i] = byte.Parse(line.Substring(1 + i * 2, 2), NumberStyles.HexNumber);
+					sum += rec[i];
+				}
+				if ((sum & 0xFF) != 0 || rec.Length != rec[0] + 5)
+					throw new FormatException("line " + number + ": bad length or checksum");
+
+				int address = (rec[1] << 8) | rec[2];
+				int type = rec[3];
+				if (type == 0)
+				{
+					for (int i = 0; i < rec[0]; i++)
+						image[upper + address + i] = rec[4 + i];
+				}
+				else if (type == 1)
+					break;
+				else if (type == 2)
+					upper = ((rec[4] << 8) | rec[5]) << 4;
+				else if (type == 4)
+					upper = ((rec[4] << 8) | rec[5]) << 16;
+			}
+			return image;
+		}
+
+		static void record(StringBuilder hex, int address, int type, byte[] data, int offset, int count)
+		{
+			int sum = count + (address >> 8) + (address & 0xFF) + type;
+			hex.Append(':').Append(count.ToString("X2")).Append(address.ToString("X4")).Append(type.ToString("X2"));
+			for (int i = offset; i < offset + count; i++)
+			{
+				hex.Append(data[i].ToString("X2"));
+				sum += data[i];
+			}
+			hex.Append(((-sum) & 0xFF).ToString("X2")).Append("\r\n");
+		}
+	}
+}
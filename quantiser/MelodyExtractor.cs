@@ -0,0 +1,275 @@
+using System;
+using System.IO;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Turns a monophonic wave file into the firmware's tune[] of chords.
+	/// </summary>
+	/*
+	 * The DDS tone engine in cylon_basic2.c reads tune[] as [length in 16
+	 * ticks, RA6 note, RA7 note] triples ending in a 0 length, where a
+	 * note indexes note_inc[]: 0 is silent and 1..25 are the semitones
+	 * A3 (220Hz) to A5 (880Hz).  The melody goes on RA6, RA7 stays silent.
+	 *
+	 * Pitch is found with YIN (de Cheveigne and Kawahara): 40ms frames
+	 * every 10ms, the cumulative mean normalised difference, and the
+	 * first dip under Threshold.  Each voiced frame is rounded to the
+	 * nearest semitone, folded by octaves into the table's range; quiet
+	 * or aperiodic frames are rests, and a 5 frame median takes out the
+	 * odd octave error.  Runs of the same note become notes; runs shorter
+	 * than MinNote are given to the note before.  A note longer than 255
+	 * lengths is split.
+	 */
+	public class MelodyExtractor
+	{
+		public struct Note
+		{
+			public int Index;		//into note_inc[], 0 for a rest
+			public int Ticks;		//length
+		}
+
+		public const int Notes = 25;			//A3 .. A5
+		public const double LowestNoteHz = 220;
+		public const int TicksPerLength = 16;	//tune[] lengths are in 16 ticks
+		static readonly string[] names = { "A", "A#", "B", "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#" };
+
+		const double FrameSeconds = 0.04;
+		const double HopSeconds = 0.01;
+		const double MinNote = 0.04;		//seconds
+		const double LowestHz = 60;
+		const double HighestHz = 1200;
+		const double Threshold = 0.15;		//YIN aperiodicity limit
+		const double SilenceDb = 35;		//below the loudest frame
+		const int Median = 5;
+
+		float[] source;
+		uint sampleRate;
+		double tickRate;
+
+		public MelodyExtractor(WaveFileReader reader, fmtChunk format, double tickRate)
+		{
+			byte[] raw = reader.ReadData();
+			source = new float[raw.Length / format.wBlockAlign];
+			Quantiser.Decode(raw, source.Length, format.wChannels, (int)format.dwBitsPerSample / 8, source);
+			sampleRate = format.dwSamplesPerSec;
+			this.tickRate = tickRate;
+		}
+
+		/*
+		 * List<Note> Extract()
+		 * The notes and rests of the clip, without leading or trailing rests.
+		 */
+		public List<Note> Extract()
+		{
+			int frame = (int)(sampleRate * FrameSeconds);
+			int hop = Math.Max(1, (int)(sampleRate * HopSeconds));
+			int frames = (source.Length >= frame) ? (source.Length - frame) / hop + 1 : 0;
+
+			//Loudness first, to know what counts as quiet.
+			double[] power = new double[frames];
+			double loudest = 0;
+			for (int f = 0; f < frames; f++)
+			{
+				double p = 0;
+				for (int i = 0; i < frame; i++)
+					p += source[f * hop + i] * source[f * hop + i];
+				power[f] = p / frame;
+				loudest = Math.Max(loudest, power[f]);
+			}
+
+			int[] note = new int[frames];		//semitone per frame
+			for (int f = 0; f < frames; f++)
+			{
+				if (power[f] <= 0 || power[f] < loudest * Math.Pow(10, -SilenceDb / 10))
+					continue;
+				double hz = pitch(f * hop, frame);
+				if (hz > 0)
+				{
+					int n = (int)Math.Round(12 * Math.Log(hz / LowestNoteHz, 2)) + 1;
+					while (n < 1)
+						n += 12;
+					while (n > Notes)
+						n -= 12;
+					note[f] = n;
+				}
+			}
+			note = median(note);
+
+			//Runs of one note, in frames.
+			List<int> runNote = new List<int>();
+			List<int> runFrames = new List<int>();
+			for (int f = 0; f < frames; f++)
+			{
+				int last = runNote.Count - 1;
+				if (last >= 0 && runNote[last] == note[f])
+					runFrames[last]++;
+				else
+				{
+					runNote.Add(note[f]);
+					runFrames.Add(1);
+				}
+			}
+			int minFrames = Math.Max(1, (int)Math.Round(MinNote / HopSeconds));
+			for (int r = 1; r < runNote.Count; )
+			{
+				if (runFrames[r] < minFrames || runNote[r] == runNote[r - 1])
+				{
+					runFrames[r - 1] += runFrames[r];
+					runNote.RemoveAt(r);
+					runFrames.RemoveAt(r);
+				}
+				else
+					r++;
+			}
+			while (runNote.Count > 0 && runNote[0] == 0)
+			{
+				runNote.RemoveAt(0);
+				runFrames.RemoveAt(0);
+			}
+			while (runNote.Count > 0 && runNote[runNote.Count - 1] == 0)
+			{
+				runNote.RemoveAt(runNote.Count - 1);
+				runFrames.RemoveAt(runFrames.Count - 1);
+			}
+
+			List<Note> notes = new List<Note>();
+			for (int r = 0; r < runNote.Count; r++)
+			{
+				Note n;
+				n.Index = runNote[r];
+				n.Ticks = (int)Math.Round(runFrames[r] * HopSeconds * tickRate);
+				if (n.Ticks > 0)
+					notes.Add(n);
+			}
+			return notes;
+		}
+
+		//Fundamental of source[start..start+frame) in Hz, or 0 if none.
+		double pitch(int start, int frame)
+		{
+			int minTau = Math.Max(2, (int)(sampleRate / HighestHz));
+			int maxTau = Math.Min(frame / 2, (int)(sampleRate / LowestHz));
+			int w = frame - maxTau;
+			if (maxTau <= minTau || w <= 0)
+				return 0;
+
+			double[] d = new double[maxTau + 2];
+			for (int tau = 1; tau <= maxTau + 1 && start + tau + w <= source.Length; tau++)
+			{
+				double s = 0;
+				for (int i = 0; i < w; i++)
+				{
+					double e = source[start + i] - source[start + i + tau];
+					s += e * e;
+				}
+				d[tau] = s;
+			}
+
+			//Cumulative mean normalised difference.
+			double[] cm = new double[maxTau + 2];
+			double sum = 0;
+			cm[0] = 1;
+			for (int tau = 1; tau <= maxTau + 1; tau++)
+			{
+				sum += d[tau];
+				cm[tau] = (sum > 0) ? d[tau] * tau / sum : 1;
+			}
+
+			for (int tau = minTau; tau <= maxTau; tau++)
+			{
+				if (cm[tau] < Threshold)
+				{
+					while (tau < maxTau && cm[tau + 1] < cm[tau])
+						tau++;
+					//Parabola through the dip for a fractional period.
+					double a = cm[tau - 1], b = cm[tau], c = cm[tau + 1];
+					double den = a - 2 * b + c;
+					double t = (den != 0) ? tau + (a - c) / (2 * den) : tau;
+					return sampleRate / t;
+				}
+			}
+			return 0;
+		}
+
+		static int[] median(int[] x)
+		{
+			int[] y = new int[x.Length];
+			int[] win = new int[Median];
+			for (int i = 0; i < x.Length; i++)
+			{
+				int n = 0;
+				for (int k = i - Median / 2; k <= i + Median / 2; k++)
+					if (k >= 0 && k < x.Length)
+						win[n++] = x[k];
+				Array.Sort(win, 0, n);
+				y[i] = win[n / 2];
+			}
+			return y;
+		}
+
+		/*
+		 * byte[] Chords(List<Note>)
+		 * The [length, RA6 note, RA7 note] triples the tone engine reads,
+		 * ending in a 0.
+		 */
+		public static byte[] Chords(List<Note> notes)
+		{
+			List<byte> chords = new List<byte>();
+			foreach (Note n in notes)
+			{
+				int count = (int)Math.Round((double)n.Ticks / TicksPerLength);
+				while (count > 0)
+				{
+					int c = Math.Min(255, count);
+					chords.Add((byte)c);
+					chords.Add((byte)n.Index);
+					chords.Add(0);
+					count -= c;
+				}
+			}
+			chords.Add(0);
+			return chords.ToArray();
+		}
+
+		/*
+		 * string NoteName(int)
+		 * 1 -> "A3", 4 -> "C4".
+		 */
+		public static string NoteName(int index)
+		{
+			if (index <= 0)
+				return "rest";
+			int semitone = index - 1 + 9;		//from C3
+			return names[(index - 1) % 12] + (3 + semitone / 12);
+		}
+
+		/*
+		 * void WriteTune(TextWriter, string, List<Note>)
+		 * Writes the notes as a tune[] initializer, one chord per line
+		 * with its note and length as a comment.
+		 */
+		public void WriteTune(TextWriter outfile, string name, List<Note> notes)
+		{
+			byte[] chords = Chords(notes);
+			outfile.WriteLine("// [length in " + TicksPerLength + " ticks, RA6 note, RA7 note], length 0 ends.");
+			outfile.WriteLine("// " + chords.Length + " bytes at a " + tickRate.ToString("F3") + " Hz tick.");
+			outfile.WriteLine("const unsigned char " + name + "[] = {");
+			foreach (Note n in notes)
+			{
+				List<Note> one = new List<Note>();
+				one.Add(n);
+				byte[] c = Chords(one);
+				if (c.Length == 1)
+					continue;		//too short to play
+				outfile.Write("\t");
+				for (int i = 0; i < c.Length - 1; i++)
+					outfile.Write(c[i] + ",");
+				outfile.WriteLine("\t// " + NoteName(n.Index) + ", " + (1000 * n.Ticks / tickRate).ToString("F0") + " ms");
+			}
+			outfile.WriteLine("\t0");
+			outfile.WriteLine("\t};");
+		}
+	}
+}
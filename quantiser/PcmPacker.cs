@@ -0,0 +1,86 @@
+using System;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Rounds window means to 4..8 bit PCM codes and packs them for the CCP1 PWM player.
+	/// </summary>
+	/*
+	 * Each window mean (0..255, 128 the silence of 8-bit wave data) is
+	 * rounded to the nearest of 2^bits levels, code 0..2^bits-1.  Codes go
+	 * into the stream LSB first, bit 0 of the first code in bit 0 of the
+	 * first byte, as the 1-bit tables are packed: 8 bit codes are whole
+	 * bytes and 4 bit codes two to a byte, low nibble first.
+	 *
+	 * ccp_pcm.c shifts each bit in from the top of the duty byte, so after
+	 * bits of them the code sits left-justified as an 8-bit duty cycle;
+	 * Level() is the sample value that duty plays back as.
+	 */
+	public class PcmPacker
+	{
+		public const int MinBits = 4;
+		public const int MaxBits = 8;
+
+		int bits;
+		int shift;		//8 - bits
+		int top;		//largest code
+
+		public PcmPacker(int bits)
+		{
+			if (bits < MinBits || bits > MaxBits)
+				throw new ArgumentOutOfRangeException("bits", "PCM must be " + MinBits + ".." + MaxBits + " bits per sample");
+			this.bits = bits;
+			shift = 8 - bits;
+			top = (1 << bits) - 1;
+		}
+
+		/*
+		 * int Next(int)
+		 * Rounds one (window mean) sample to a code.
+		 */
+		public int Next(int sample)
+		{
+			int code = (sample + ((1 << shift) >> 1)) >> shift;
+			return (code > top) ? top : code;
+		}
+
+		/*
+		 * int Level(int)
+		 * The 8-bit sample a code plays back as: its duty cycle in 256ths.
+		 */
+		public int Level(int code)
+		{
+			return code << shift;
+		}
+
+		/*
+		 * int Pack(...)
+		 * Like SigmaDelta.Pack, but windows (a multiple of 8) means become
+		 * windows/8*bits bytes of codes in dst.
+		 */
+		public int Pack(byte[] src, int offset, int windows, int window, byte[] dst, int dstOffset)
+		{
+			int p = offset;
+			int q = dstOffset;
+			int acc = 0;		//bits not yet written, LSB first
+			int held = 0;
+
+			for (int k = 0; k < windows; k++)
+			{
+				int t = 0;
+				for (int s = 0; s < window; s++)
+					t += src[p + s];
+				p += window;
+				acc |= Next(t / window) << held;
+				held += bits;
+				while (held >= 8)
+				{
+					dst[q++] = (byte)acc;
+					acc >>= 8;
+					held -= 8;
+				}
+			}
+			return q - dstOffset;
+		}
+	}
+}
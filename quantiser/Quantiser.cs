@@ -0,0 +1,200 @@
+using System;
+using System.IO;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// The 1-bit quantiser itself: PCM frames in, packed sound bytes out.
+	/// </summary>
+	/*
+	 * Converts PCM to a 1-bit stream packed LSB first (or, in Pcm mode,
+	 * to 4..8 bit codes packed the same way by PcmPacker, and in Adpcm
+	 * mode to ImaAdpcm's 4-bit codes).  8 and 16 bit
+	 * frames of any channel count are mixed down to one 8-bit channel.
+	 *
+	 * With a playback rate set, the audio is resampled to exactly that
+	 * rate and each sample becomes one bit, so the ISR plays one bit per
+	 * tick.  Otherwise each bit is the mean of a window of samples, 11 by
+	 * default, as the existing sound tables were made.
+	 *
+	 * Whole groups of 8 windows go through BitPacker.Pack (or the
+	 * sigma-delta encoder) a block at a time; the samples left over are
+	 * carried to the front of the next block, and a short window or byte
+	 * at the end is still emitted.  Every buffer is sized by the block, so
+	 * memory stays fixed however long the input runs.
+	 */
+	public class Quantiser
+	{
+		int level;
+		int channels;
+		int width;			//bytes per sample
+		int frame;			//bytes per frame
+		int window;
+		int bits;			//per window: 1, or PCM bits
+		Resampler rs;
+		SigmaDelta sd;
+		PcmPacker pcm;
+		ImaAdpcm adpcm;
+
+		public Quantiser(fmtChunk format, QuantiseSettings settings)
+		{
+			channels = format.wChannels;
+			width = (int)format.dwBitsPerSample / 8;
+			if ((width != 1 && width != 2) || channels < 1)
+				throw new NotSupportedException("Only 8 and 16 bit PCM is supported, not " + format.dwBitsPerSample + " bit x " + channels);
+			frame = width * channels;
+			level = settings.Level;
+
+			if (settings.Window < 1 || settings.Window > 128)
+				throw new ArgumentOutOfRangeException("settings", "window must be 1..128 samples");
+			window = settings.Window;
+			if (settings.RateNum > 0)
+			{
+				rs = new Resampler(format.dwSamplesPerSec, settings.RateNum, settings.RateDen);
+				window = 1;
+			}
+
+			bits = 1;
+			if (settings.Mode == QuantiseMode.SigmaDelta1)
+				sd = new SigmaDelta(1, level);
+			else if (settings.Mode == QuantiseMode.SigmaDelta2)
+				sd = new SigmaDelta(2, level);
+			else if (settings.Mode == QuantiseMode.Pcm)
+			{
+				pcm = new PcmPacker(settings.Bits);
+				bits = settings.Bits;
+			}
+			else if (settings.Mode == QuantiseMode.Adpcm)
+			{
+				adpcm = new ImaAdpcm();
+				bits = 4;
+			}
+		}
+
+		/*
+		 * void Run(Stream, long, Stream, int)
+		 * Quantises up to length bytes of input (or to the end of the
+		 * stream), reading blockSize bytes at a time and flushing output
+		 * after each block.  Small blocks keep the latency down when the
+		 * input is a live stream.
+		 */
+		public void Run(Stream input, long length, Stream output, int blockSize)
+		{
+			byte[] raw = new byte[blockSize];
+			float[] mono = new float[blockSize / frame];
+			byte[] dataset1 = new byte[blockSize + window * 8];
+			byte[] packed = new byte[blockSize / 8 * bits + bits];
+			long remaining = length;
+			int rawHeld = 0;    // bytes of a part frame carried over
+			int held = 0;       // samples carried over from the last block
+
+			bool more = true;
+			while (more)
+			{
+				int n = 0;
+				if (remaining > 0)
+					n = input.Read(raw, rawHeld, (int)Math.Min(remaining, (long)(raw.Length - rawHeld)));
+				if (n <= 0)
+					more = false;   // end of chunk, or a truncated file: keep what we have
+				remaining -= n;
+				rawHeld += n;
+
+				int frames = rawHeld / frame;
+				Decode(raw, frames, channels, width, mono);
+				rawHeld -= frames * frame;
+				Array.Copy(raw, frames * frame, raw, 0, rawHeld);
+
+				int need = held + (rs != null ? rs.MaxOutput(frames) : frames);
+				if (dataset1.Length < need)
+					Array.Resize(ref dataset1, need);
+				if (rs != null)
+					held += more ? rs.Process(mono, frames, dataset1, held) : rs.Flush(dataset1, held);
+				else
+				{
+					for (int k = 0; k < frames; k++)
+						dataset1[held + k] = toByte(mono[k]);
+					held += frames;
+				}
+
+				int windows = held / (window * 8) * 8;
+				if (packed.Length < windows / 8 * bits)
+					Array.Resize(ref packed, windows / 8 * bits);
+				int bytes;
+				if (pcm != null)
+					bytes = pcm.Pack(dataset1, 0, windows, window, packed, 0);
+				else if (adpcm != null)
+					bytes = adpcm.Pack(dataset1, 0, windows, window, packed, 0);
+				else if (sd == null)
+					bytes = BitPacker.Pack(dataset1, 0, windows, window, level, packed, 0);
+				else
+					bytes = sd.Pack(dataset1, 0, windows, window, packed, 0);
+				output.Write(packed, 0, bytes);
+				output.Flush();
+
+				int used = windows * window;
+				held -= used;
+				Array.Copy(dataset1, used, dataset1, 0, held);
+			}
+
+			//Flush the tail: a part window is averaged over what it holds
+			//and a part byte is padded with zero bits.
+			int bp = 1;
+			int bo = 0;
+			for (int j = 0; j < held; j += window)
+			{
+				int s = Math.Min(window, held - j);
+				long t = 0;
+				for (int k = 0; k < s; k++)
+					t += dataset1[j + k];
+				int code;
+				if (pcm != null)
+					code = pcm.Next((int)(t / s));
+				else if (adpcm != null)
+					code = adpcm.Next((int)(t / s));
+				else
+					code = (sd == null ? t / s > level : sd.Next((int)(t / s)) != 0) ? 1 : 0;
+				for (int b = 0; b < bits; b++)
+				{
+					if (((code >> b) & 1) != 0)
+						bo = bo | bp;
+					bp = bp << 1;
+					if (bp == 0x100)
+					{
+						output.WriteByte((byte)bo);
+						bp = 1;
+						bo = 0;
+					}
+				}
+			}
+			if (bp != 1)
+				output.WriteByte((byte)bo);
+			output.Flush();
+		}
+
+		//Mixes frames of 8-bit unsigned or 16-bit signed samples down to
+		//one channel in -1..1.
+		public static void Decode(byte[] raw, int frames, int channels, int width, float[] mono)
+		{
+			int p = 0;
+			for (int f = 0; f < frames; f++)
+			{
+				int sum = 0;
+				for (int c = 0; c < channels; c++)
+				{
+					if (width == 1)
+						sum += (raw[p] - 128) << 8;
+					else
+						sum += (short)(raw[p] | (raw[p + 1] << 8));
+					p += width;
+				}
+				mono[f] = sum / (32768f * channels);
+			}
+		}
+
+		static byte toByte(float v)
+		{
+			int b = (int)Math.Round(v * 128.0) + 128;
+			return (byte)(b < 0 ? 0 : (b > 255 ? 255 : b));
+		}
+	}
+}
@@ -0,0 +1,193 @@
+using System;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Streaming rational-ratio resampler with a windowed-sinc anti-alias filter.
+	/// </summary>
+	/*
+	 * Resamples from srcRate to rateNum/rateDen Hz, e.g. the Timer0 tick
+	 * rate PIC_CLK / (4 * 256 * prescale).  The ratio is reduced to L/M
+	 * and output n sits exactly at input position n*M/L, tracked as an
+	 * integer index plus a phase 0..L-1, so there is no drift however long
+	 * the clip.  Each phase has its own set of Blackman windowed sinc taps
+	 * (precomputed while L is small), cut off below the lower of the two
+	 * Nyquist rates and normalised to unity gain at DC.
+	 *
+	 * Input goes in as floats in -1..1 a block at a time; output comes out
+	 * as 8-bit unsigned samples centred on 128, as in an 8-bit wave file.
+	 */
+	public class Resampler
+	{
+		const int ZeroCrossings = 8;	//sinc lobes each side of centre at the output rate
+		const double Rolloff = 0.9;		//pass band, as a fraction of the output Nyquist
+		const int MaxTable = 1 << 20;	//largest phase table kept in memory
+
+		long L, M;			//output / input rate ratio, reduced
+		int half;			//taps each side of the output position
+		float[] table;		//L phases of 2*half taps, or null
+		double cutoff;		//cycles per input sample
+
+		float[] hist;		//input samples from base onwards
+		long basePos;		//input index of hist[0]
+		int count;			//valid samples in hist
+		long ipos;			//input index at or before the next output
+		long phase;			//and how far past it, in 1/L steps
+		long inputs;		//total samples pushed
+
+		public Resampler(uint srcRate, long rateNum, long rateDen)
+		{
+			if (srcRate == 0 || rateNum <= 0 || rateDen <= 0)
+				throw new ArgumentOutOfRangeException("rateNum", "sample rates must be positive");
+
+			L = rateNum;
+			M = rateDen * srcRate;
+			long g = gcd(L, M);
+			L /= g;
+			M /= g;
+
+			double ratio = Math.Min(1.0, (double)L / M);
+			cutoff = 0.5 * ratio * Rolloff;
+			half = (int)Math.Ceiling(ZeroCrossings / ratio);
+
+			if (L * 2 * half <= MaxTable)
+			{
+				table = new float[L * 2 * half];
+				for (long p = 0; p < L; p++)
+					taps(p, table, (int)(p * 2 * half));
+			}
+
+			hist = new float[4 * half + 256];
+			//The first output lines up with the first input sample; pretend
+			//there was silence before it.
+			count = half;
+			basePos = -half;
+		}
+
+		/*
+		 * int MaxOutput(int)
+		 * Most samples Process can produce for n more inputs, or Flush for n=0.
+		 */
+		public int MaxOutput(int n)
+		{
+			return (int)(((long)n + 2 * half + 1) * L / M) + 2;
+		}
+
+		/*
+		 * int Process(float[], int, byte[], int)
+		 * Pushes n input samples and writes every output that now has its
+		 * full set of taps into dst from dstOffset.  Returns how many.
+		 */
+		public int Process(float[] src, int n, byte[] dst, int dstOffset)
+		{
+			int produced = 0;
+			int i = 0;
+			while (i < n)
+			{
+				if (count == hist.Length)
+					compact();
+				int take = Math.Min(n - i, hist.Length - count);
+				Array.Copy(src, i, hist, count, take);
+				count += take;
+				i += take;
+				inputs += take;
+				produced += drain(dst, dstOffset + produced, basePos + count);
+			}
+			return produced;
+		}
+
+		/*
+		 * int Flush(byte[], int)
+		 * Pads with silence and writes the outputs that fall inside the
+		 * input, so none of the clip is lost.
+		 */
+		public int Flush(byte[] dst, int dstOffset)
+		{
+			int produced = 0;
+			long end = inputs;
+			float[] zeros = new float[half + 1];
+			while (ipos < end)
+			{
+				if (count + zeros.Length > hist.Length)
+					compact();
+				Array.Copy(zeros, 0, hist, count, zeros.Length);
+				count += zeros.Length;
+				produced += drain(dst, dstOffset + produced, Math.Min(basePos + count, end + half));
+			}
+			return produced;
+		}
+
+		int drain(byte[] dst, int dstOffset, long limit)
+		{
+			int produced = 0;
+			float[] t = (table == null) ? new float[2 * half] : null;
+
+			//Output at ipos + phase/L reads ipos-half+1 .. ipos+half.
+			while (ipos + half < limit && ipos - half + 1 >= basePos)
+			{
+				int at = (int)(ipos - half + 1 - basePos);
+				float[] h = table;
+				int ho = 0;
+				if (table == null)
+				{
+					taps(phase, t, 0);
+					h = t;
+				}
+				else
+					ho = (int)(phase * 2 * half);
+
+				double acc = 0;
+				for (int k = 0; k < 2 * half; k++)
+					acc += hist[at + k] * h[ho + k];
+
+				int v = (int)Math.Round(acc * 128.0) + 128;
+				dst[dstOffset + produced++] = (byte)(v < 0 ? 0 : (v > 255 ? 255 : v));
+
+				phase += M;
+				ipos += phase / L;
+				phase %= L;
+			}
+			return produced;
+		}
+
+		//Drops the samples no later output can reach.
+		void compact()
+		{
+			long keep = ipos - half + 1;
+			int drop = (int)Math.Max(0, Math.Min(keep - basePos, (long)count));
+			Array.Copy(hist, drop, hist, 0, count - drop);
+			count -= drop;
+			basePos += drop;
+			if (count == hist.Length)
+				Array.Resize(ref hist, hist.Length * 2);
+		}
+
+		void taps(long p, float[] dst, int offset)
+		{
+			double frac = (double)p / L;
+			double sum = 0;
+			for (int k = 0; k < 2 * half; k++)
+			{
+				double x = (k - half + 1) - frac;	//input distance from the output position
+				double u = x / half;
+				double w = (Math.Abs(u) >= 1) ? 0 : 0.42 + 0.5 * Math.Cos(Math.PI * u) + 0.08 * Math.Cos(2 * Math.PI * u);
+				double s = (x == 0) ? 2 * cutoff : Math.Sin(2 * Math.PI * cutoff * x) / (Math.PI * x);
+				dst[offset + k] = (float)(s * w);
+				sum += s * w;
+			}
+			for (int k = 0; k < 2 * half; k++)
+				dst[offset + k] = (float)(dst[offset + k] / sum);
+		}
+
+		static long gcd(long a, long b)
+		{
+			while (b != 0)
+			{
+				long t = a % b;
+				a = b;
+				b = t;
+			}
+			return a;
+		}
+	}
+}
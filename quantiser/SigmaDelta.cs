@@ -0,0 +1,88 @@
+using System;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// First and second order sigma-delta (PDM) encoder for the 1-bit sound tables.
+	/// </summary>
+	/*
+	 * Rather than cutting each window mean at the level, the encoder feeds
+	 * the quantisation error forward so the density of 1s follows the
+	 * signal.  Second order shapes the error with (1 - z^-1)^2, pushing it
+	 * up towards the tick rate where the piezo and the ear roll off.
+	 *
+	 * Samples are taken relative to level (the mid-scale, 128 for 8-bit
+	 * wave data) and the output swings between +/-FullScale.  The state
+	 * carries across Pack() calls so a chunk can be fed a block at a time.
+	 */
+	public class SigmaDelta
+	{
+		const int FullScale = 128;
+		const int ErrorLimit = 4 * FullScale;	//keeps order 2 from running away on clipped input
+
+		int order;
+		int level;
+		int e1;		//last quantisation error
+		int e2;		//the one before
+
+		public SigmaDelta(int order, int level)
+		{
+			if (order < 1 || order > 2)
+				throw new ArgumentOutOfRangeException("order", "sigma-delta order must be 1 or 2");
+			this.order = order;
+			this.level = level;
+		}
+
+		/*
+		 * int Next(int)
+		 * Encodes one (window mean) sample, returns the output bit.
+		 */
+		public int Next(int sample)
+		{
+			int x = sample - level;
+			int v;
+
+			if (order == 1)
+				v = x - e1;
+			else
+				v = x - 2 * e1 + e2;
+
+			int y = (v >= 0) ? FullScale : -FullScale;
+			int e = y - v;
+			if (e > ErrorLimit)
+				e = ErrorLimit;
+			else if (e < -ErrorLimit)
+				e = -ErrorLimit;
+
+			e2 = e1;
+			e1 = e;
+			return (y > 0) ? 1 : 0;
+		}
+
+		/*
+		 * int Pack(...)
+		 * Same contract as BitPacker.Pack: windows (a multiple of 8) window
+		 * means from src are encoded LSB first into windows/8 bytes of dst.
+		 */
+		public int Pack(byte[] src, int offset, int windows, int window, byte[] dst, int dstOffset)
+		{
+			int n = windows >> 3;
+			int p = offset;
+
+			for (int k = 0; k < n; k++)
+			{
+				int bo = 0;
+				for (int b = 0; b < 8; b++)
+				{
+					int t = 0;
+					for (int s = 0; s < window; s++)
+						t += src[p + s];
+					p += window;
+					bo |= Next(t / window) << b;
+				}
+				dst[dstOffset + k] = (byte)bo;
+			}
+			return n;
+		}
+	}
+}
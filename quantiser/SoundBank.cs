@@ -0,0 +1,197 @@
+using System;
+using System.IO;
+using System.Text;
+using System.Threading;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Quantises a list of wave files in parallel and writes them out as one sound bank header.
+	/// </summary>
+	/*
+	 * The header holds a SOUND_<NAME> id per clip, an index of byte offset
+	 * and byte length pairs, and every clip's bitstream back to back:
+	 *
+	 *   #define SOUND_EYE   0
+	 *   #define SOUND_COUNT 2
+	 *   const unsigned int sound_index[] = { 0,378, 378,240, };
+	 *   const unsigned char sound_bank[] = { ... };
+	 *
+	 * so play_sound(sound_id) finds its clip at sound_index[sound_id*2].
+	 * With Compress set each clip is a SoundCompressor stream, the index
+	 * gives packed lengths and SOUND_LZ is defined.  Pcm clips define
+	 * SOUND_PCM as their bits per sample, Adpcm clips SOUND_ADPCM.
+	 *
+	 * WriteFlash() puts the clips in a binary image for a 25-series SPI
+	 * flash instead, from address 0, and the header keeps only the ids
+	 * and an index of 32-bit addresses, with SOUND_SPI defined.
+	 */
+	public class SoundBank
+	{
+		string[] files;
+		byte[][] clips;
+		string[] errors;
+		QuantiseSettings settings;
+		int next = -1;		//last file taken by a worker
+
+		public bool Compress;	//SoundCompressor each clip, for the ISR decoder
+
+		public SoundBank(string[] files, QuantiseSettings settings)
+		{
+			this.files = files;
+			this.settings = settings;
+			clips = new byte[files.Length][];
+			errors = new string[files.Length];
+		}
+
+		/*
+		 * bool Build()
+		 * Quantises every file, one worker thread per core.  Returns false
+		 * (after reporting each failure) if any clip could not be made.
+		 */
+		public bool Build()
+		{
+			int workers = Math.Min(Environment.ProcessorCount, files.Length);
+			Thread[] threads = new Thread[workers];
+			for (int i = 0; i < workers; i++)
+			{
+				threads[i] = new Thread(new ThreadStart(work));
+				threads[i].Start();
+			}
+			for (int i = 0; i < workers; i++)
+				threads[i].Join();
+
+			bool ok = true;
+			for (int i = 0; i < files.Length; i++)
+			{
+				if (errors[i] != null)
+				{
+					Console.WriteLine(files[i] + ": " + errors[i]);
+					ok = false;
+				}
+			}
+			return ok;
+		}
+
+		void work()
+		{
+			int i;
+			while ((i = Interlocked.Increment(ref next)) < files.Length)
+			{
+				try
+				{
+					using (WaveFileReader reader = new WaveFileReader(files[i]))
+					{
+						WaveFile contents = reader.ReadHeaders(files[i]);
+						if (contents.data == null)
+						{
+							errors[i] = "no data chunk";
+							continue;
+						}
+						MemoryStream packed = new MemoryStream();
+						if (reader.quantise(packed, settings))
+							clips[i] = Compress ? SoundCompressor.Compress(packed.ToArray()) : packed.ToArray();
+						else
+							errors[i] = "quantise failed";
+					}
+				}
+				catch (Exception e)
+				{
+					errors[i] = e.Message;
+				}
+			}
+		}
+
+		/*
+		 * void Write(TextWriter)
+		 * Writes the ids, the index table and the concatenated bitstreams.
+		 */
+		public void Write(TextWriter outfile)
+		{
+			outfile.WriteLine("/* Sound bank generated by WaveEdit -bank, do not edit. */");
+			outfile.WriteLine("");
+			writeDefines(outfile);
+			outfile.WriteLine("");
+
+			writeIndex(outfile, "unsigned int", "sound_bank[]");
+			byte[] bank = image();
+			WaveFileReader.WriteTable(outfile, "sound_bank", bank, 0, bank.Length);
+			outfile.WriteLine("");
+		}
+
+		/*
+		 * void WriteFlash(TextWriter, Stream, string)
+		 * Writes the clips back to back to image, to be programmed into
+		 * the serial flash from address 0, and the ids and address index
+		 * to the header; imageName goes in the header's comments.
+		 */
+		public void WriteFlash(TextWriter outfile, Stream image, string imageName)
+		{
+			outfile.WriteLine("/* Sound bank generated by WaveEdit -bank -flash, do not edit. */");
+			outfile.WriteLine("");
+			writeDefines(outfile);
+			outfile.WriteLine("#define SOUND_SPI\t1\t/* clips are in " + Path.GetFileName(imageName) + " on the SPI flash */");
+			outfile.WriteLine("");
+
+			writeIndex(outfile, "unsigned long", Path.GetFileName(imageName));
+			byte[] bank = this.image();
+			image.Write(bank, 0, bank.Length);
+		}
+
+		void writeDefines(TextWriter outfile)
+		{
+			for (int i = 0; i < files.Length; i++)
+				outfile.WriteLine("#define " + SymbolName(files[i]) + "\t" + i + "\t/* " + Path.GetFileName(files[i]) + ", " + clips[i].Length + " bytes */");
+			outfile.WriteLine("#define SOUND_COUNT\t" + files.Length);
+			if (Compress)
+				outfile.WriteLine("#define SOUND_LZ\t1\t/* clips are SoundCompressor streams */");
+			if (settings.Mode == QuantiseMode.Pcm)
+				outfile.WriteLine("#define SOUND_PCM\t" + settings.Bits + "\t/* bits per sample, LSB first */");
+			else if (settings.Mode == QuantiseMode.Adpcm)
+				outfile.WriteLine("#define SOUND_ADPCM\t1\t/* IMA ADPCM, 4 bits per sample, low nibble first */");
+		}
+
+		void writeIndex(TextWriter outfile, string type, string where)
+		{
+			outfile.WriteLine("// [offset, length] in bytes of each clip in " + where);
+			outfile.WriteLine("const " + type + " sound_index[] = {");
+			long offset = 0;
+			for (int i = 0; i < files.Length; i++)
+			{
+				outfile.WriteLine("\t" + offset + "," + clips[i].Length + ",");
+				offset += clips[i].Length;
+			}
+			outfile.WriteLine("};");
+			outfile.WriteLine("");
+		}
+
+		//Every clip back to back.
+		byte[] image()
+		{
+			int total = 0;
+			for (int i = 0; i < files.Length; i++)
+				total += clips[i].Length;
+			byte[] bank = new byte[total];
+			int offset = 0;
+			for (int i = 0; i < files.Length; i++)
+			{
+				Array.Copy(clips[i], 0, bank, offset, clips[i].Length);
+				offset += clips[i].Length;
+			}
+			return bank;
+		}
+
+		/*
+		 * string SymbolName(string)
+		 * "sounds/Eye-2.wav" -> "SOUND_EYE_2"
+		 */
+		public static string SymbolName(string file)
+		{
+			StringBuilder name = new StringBuilder("SOUND_");
+			foreach (char c in Path.GetFileNameWithoutExtension(file).ToUpper())
+				name.Append(Char.IsLetterOrDigit(c) && c < 128 ? c : '_');
+			return name.ToString();
+		}
+	}
+}
@@ -0,0 +1,152 @@
+using System;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Small-window LZ compression of packed sound bytes, sized for the Timer0 ISR decoder.
+	/// </summary>
+	/*
+	 * The stream is a sequence of one byte tokens:
+	 *
+	 *   0nnnnnnn            n+1 literal bytes follow (1..128)
+	 *   1llddddd            copy l+2 bytes (2..5) from d+1 bytes back (1..32)
+	 *
+	 * Copies read the decoder's last 32 output bytes, which it keeps in a
+	 * RAM ring, so a run of zeros is a distance 1 copy and a repeating
+	 * pattern like 99,140,49,198,24 a distance 5 one.  The decoder only
+	 * touches the stream once every 8 ticks, and never reads more than
+	 * two bytes of it for one output byte.  There is no terminator: the
+	 * sound index gives the packed length.
+	 */
+	public sealed class SoundCompressor
+	{
+		public const int Window = 32;
+		public const int MinMatch = 2;
+		public const int MaxMatch = 5;
+		public const int MaxLiterals = 128;
+
+		private SoundCompressor() {}
+
+		/*
+		 * byte[] Compress(byte[])
+		 * Picks the cheapest token sequence with a shortest path over the
+		 * input; clips are a few K at most so the exhaustive search is cheap.
+		 */
+		public static byte[] Compress(byte[] src)
+		{
+			int n = src.Length;
+			int[] cost = new int[n + 1];	//bytes to code src[i..]
+			int[] step = new int[n + 1];	//>0 literals, <0 -(copy length)
+			int[] dist = new int[n + 1];
+
+			for (int i = n - 1; i >= 0; i--)
+			{
+				cost[i] = int.MaxValue;
+				for (int k = 1; k <= MaxLiterals && i + k <= n; k++)
+				{
+					if (1 + k + cost[i + k] < cost[i])
+					{
+						cost[i] = 1 + k + cost[i + k];
+						step[i] = k;
+					}
+				}
+				for (int d = 1; d <= Window && d <= i; d++)
+				{
+					int l = 0;
+					while (l < MaxMatch && i + l < n && src[i + l] == src[i + l - d])
+						l++;
+					for (int m = MinMatch; m <= l; m++)
+					{
+						if (1 + cost[i + m] < cost[i])
+						{
+							cost[i] = 1 + cost[i + m];
+							step[i] = -m;
+							dist[i] = d;
+						}
+					}
+				}
+			}
+
+			List<byte> dst = new List<byte>(cost[0]);
+			for (int i = 0; i < n; )
+			{
+				if (step[i] > 0)
+				{
+					dst.Add((byte)(step[i] - 1));
+					for (int k = 0; k < step[i]; k++)
+						dst.Add(src[i + k]);
+					i += step[i];
+				}
+				else
+				{
+					dst.Add((byte)(0x80 | ((-step[i] - MinMatch) << 5) | (dist[i] - 1)));
+					i += -step[i];
+				}
+			}
+			return dst.ToArray();
+		}
+
+		/*
+		 * byte[] Expand(byte[])
+		 * Reference decoder, the same steps as the ISR takes.
+		 */
+		public static byte[] Expand(byte[] src)
+		{
+			List<byte> dst = new List<byte>();
+			int p = 0;
+			while (p < src.Length)
+			{
+				int tok = src[p++];
+				if ((tok & 0x80) == 0)
+				{
+					for (int k = 0; k <= tok; k++)
+						dst.Add(src[p++]);
+				}
+				else
+				{
+					int d = (tok & 0x1F) + 1;
+					int l = ((tok >> 5) & 3) + MinMatch;
+					for (int k = 0; k < l; k++)
+						dst.Add(dst[dst.Count - d]);
+				}
+			}
+			return dst.ToArray();
+		}
+
+		/*
+		 * bool SelfTest()
+		 * Round trips random, run-heavy and periodic data.
+		 */
+		public static bool SelfTest()
+		{
+			Random rnd = new Random(628);
+			for (int pass = 0; pass < 100; pass++)
+			{
+				byte[] src = new byte[rnd.Next(2000)];
+				int period = 1 + rnd.Next(40);
+				for (int i = 0; i < src.Length; i++)
+				{
+					if (pass % 3 == 0)
+						src[i] = (byte)rnd.Next(256);
+					else if (pass % 3 == 1)
+						src[i] = (byte)((rnd.Next(8) == 0) ? rnd.Next(256) : 0);
+					else
+						src[i] = (byte)((i < period) ? rnd.Next(256) : src[i - period]);
+				}
+
+				byte[] back = Expand(Compress(src));
+				bool same = back.Length == src.Length;
+				for (int i = 0; same && i < src.Length; i++)
+					same = back[i] == src[i];
+				if (!same)
+				{
+					Console.WriteLine("SoundCompressor: round trip failed, pass " + pass);
+					return false;
+				}
+			}
+			Console.WriteLine("SoundCompressor: ok");
+			return true;
+		}
+	}
+}
@@ -55,4 +55,23 @@ namespace KadeSoft
 			//public short [] shortArray;    //16 bit - signed
 		}
 
+	//How quantise turns window means into bits.
+	public enum QuantiseMode {
+			Threshold,		//mean > level, the original hard cut
+			SigmaDelta1,	//first order sigma-delta
+			SigmaDelta2,	//second order, noise shaped
+			Pcm,			//multi-bit samples for the CCP1 PWM player
+			Adpcm			//4-bit IMA ADPCM for the same player
+		}
+
+	//Everything that decides how a clip is quantised.
+	public class QuantiseSettings {
+			public int          Level = 128;	//threshold, or mid-scale for sigma-delta
+			public QuantiseMode Mode = QuantiseMode.Threshold;
+			public int          Window = 11;	//samples averaged per bit when not resampling
+			public long         RateNum = 0;	//playback rate RateNum/RateDen Hz, one bit per
+			public long         RateDen = 1;	//sample; RateNum 0 to use Window instead
+			public int          Bits = 8;		//bits per sample in Pcm mode, 4..8
+		}
+
 }
@@ -0,0 +1,230 @@
+using System;
+using System.IO;
+using System.Text;
+using System.Globalization;
+using System.Collections.Generic;
+
+namespace KadeSoft
+{
+	/// <summary>
+	/// Compiles an RTTTL tune into the one byte per note ROM format of the cylon_plus.c player.
+	/// </summary>
+	/*
+	 * RTTTL is name:d=4,o=5,b=120:8e,8p,4c#6,2a.  Each note is
+	 * [length]name[#][.][octave][.], p is a rest, and d, o and b are the
+	 * default length, default octave and quarter notes per minute.
+	 *
+	 * The output is
+	 *
+	 *   note_inc[32]    DDS phase increments per tick for this clock:
+	 *                   1 = A3, 2 = A#3 ... 30 = D6, 31 = rest (0)
+	 *   tune[]          tune[0] ticks per 1/32 note, then one byte per
+	 *                   note, dddnnnnn: n is the note_inc[] index and
+	 *                   d the length in 1/32 notes, 1 2 4 8 16 32 6 12
+	 *                   (tune_len[] in the player); a 0 byte ends it.
+	 *
+	 * Other lengths (a dotted half, say) become tied notes, which the DDS
+	 * engine plays without a break.  The tune is moved by whole octaves
+	 * to fit the most notes under the tick's Nyquist limit; anything
+	 * still outside is folded in and reported.
+	 */
+	public class TuneCompiler
+	{
+		public const int Rest = 31;
+		public const int HighestIndex = 30;
+		public static readonly int[] Lengths = { 1, 2, 4, 8, 16, 32, 6, 12 };	//1/32 notes per code
+		const double LowestNoteHz = 220;	//index 1, A3
+		static readonly int[] Semitones = { 0, 2, 4, 5, 7, 9, 11, 11 };	//c d e f g a b h above c
+
+		double tickRate;
+		int ticksPer32;
+		int highest;			//highest index under Nyquist
+		int shift;				//octaves the tune was moved by
+		List<string> warnings = new List<string>();
+		List<byte> notes = new List<byte>();
+		string name = "";
+
+		public TuneCompiler(double tickRate)
+		{
+			this.tickRate = tickRate;
+			highest = 0;
+			for (int n = 1; n <= HighestIndex; n++)
+				if (frequency(n) < tickRate / 2)
+					highest = n;
+		}
+
+		static double frequency(int index)
+		{
+			return LowestNoteHz * Math.Pow(2, (index - 1) / 12.0);
+		}
+
+		/*
+		 * void Compile(string)
+		 * Parses one RTTTL tune.  Throws FormatException with the offending
+		 * part if it is not RTTTL or cannot be played at this tick.
+		 */
+		public void Compile(string rtttl)
+		{
+			string[] parts = rtttl.Trim().Split(':');
+			if (parts.Length != 3)
+				throw new FormatException("expected name:defaults:notes");
+			name = parts[0].Trim();
+
+			int defLength = 4, defOctave = 6, bpm = 63;		//the RTTTL defaults
+			foreach (string d in parts[1].Split(','))
+			{
+				string[] kv = d.Split('=');
+				if (kv.Length != 2)
+					continue;
+				int v = int.Parse(kv[1].Trim());
+				switch (kv[0].Trim().ToLower())
+				{
+					case "d": defLength = v; break;
+					case "o": defOctave = v; break;
+					case "b": bpm = v; break;
+				}
+			}
+
+			double exact = tickRate * 60 / (8.0 * bpm);
+			ticksPer32 = (int)Math.Round(exact);
+			if (ticksPer32 < 1 || ticksPer32 > 255)
+				throw new FormatException("b=" + bpm + " is " + exact.ToString("F1") + " ticks per 1/32 note; it must be 1..255, use another prescaler");
+
+			//Each note as a semitone from A3 (or -1 for a rest) and 1/32 notes.
+			List<int> pitch = new List<int>();
+			List<int> length = new List<int>();
+			foreach (string raw in parts[2].Split(','))
+			{
+				string n = raw.Trim().ToLower();
+				if (n.Length == 0)
+					continue;
+				int p = 0;
+				int len = 0;
+				while (p < n.Length && Char.IsDigit(n[p]))
+					len = len * 10 + (n[p++] - '0');
+				if (len == 0)
+					len = defLength;
+				if (p >= n.Length || "cdefgabhp".IndexOf(n[p]) < 0)
+					throw new FormatException("'" + raw.Trim() + "' is not a note");
+				char letter = n[p++];
+				int semitone = (letter == 'p') ? -1 : Semitones["cdefgabh".IndexOf(letter)];
+				if (p < n.Length && n[p] == '#')
+				{
+					if (semitone >= 0)
+						semitone++;
+					p++;
+				}
+				bool dotted = false;
+				if (p < n.Length && n[p] == '.')
+				{
+					dotted = true;
+					p++;
+				}
+				int octave = defOctave;
+				if (p < n.Length && Char.IsDigit(n[p]))
+					octave = n[p++] - '0';
+				if (p < n.Length && n[p] == '.')
+				{
+					dotted = true;
+					p++;
+				}
+				if (p != n.Length || 32 % len != 0)
+					throw new FormatException("'" + raw.Trim() + "' is not a note");
+
+				//Counted from A3, so c4 is 3 and a4 is 12.
+				if (semitone >= 0)
+					semitone += (octave - 3) * 12 - 9;
+				pitch.Add(semitone);
+				length.Add(32 / len * (dotted ? 3 : 2) / 2);
+			}
+			if (pitch.Count == 0)
+				throw new FormatException("no notes");
+
+			//Whole octaves that fit the most notes.
+			int best = -1;
+			for (int s = -4; s <= 4; s++)
+			{
+				int fit = 0;
+				foreach (int q in pitch)
+					if (q < 0 || (q + s * 12 >= 0 && q + s * 12 < highest))
+						fit++;
+				if (fit > best || (fit == best && Math.Abs(s) < Math.Abs(shift)))
+				{
+					best = fit;
+					shift = s;
+				}
+			}
+			if (shift != 0)
+				warnings.Add("moved " + (shift > 0 ? "up " : "down ") + Math.Abs(shift) + " octave(s) to fit A3.." + MelodyExtractor.NoteName(highest));
+			if (best < pitch.Count)
+				warnings.Add((pitch.Count - best) + " note(s) folded by octaves into range");
+
+			notes.Clear();
+			for (int i = 0; i < pitch.Count; i++)
+			{
+				int index = Rest;
+				if (pitch[i] >= 0)
+				{
+					int q = pitch[i] + shift * 12;
+					while (q < 0)
+						q += 12;
+					while (q >= highest)
+						q -= 12;
+					index = q + 1;
+				}
+				//Longest codes first; anything left is a tie.
+				for (int left = length[i]; left > 0; )
+				{
+					int code = 0;
+					for (int c = 0; c < Lengths.Length; c++)
+						if (Lengths[c] <= left && Lengths[c] > Lengths[code])
+							code = c;
+					notes.Add((byte)((code << 5) | index));
+					left -= Lengths[code];
+				}
+			}
+		}
+
+		/*
+		 * void Write(TextWriter, string)
+		 * Writes note_inc[] and tune[] as a header for the player.
+		 */
+		public void Write(TextWriter outfile, string source)
+		{
+			foreach (string w in warnings)
+				Console.WriteLine(name + ": " + w);
+			CultureInfo c = CultureInfo.InvariantCulture;
+
+			outfile.WriteLine("/* Tune \"" + name + "\" compiled by WaveEdit -rtttl from " + Path.GetFileName(source) + ", do not edit. */");
+			outfile.WriteLine("/* " + tickRate.ToString("F3", c) + " Hz tick, " + notes.Count + " notes, " + (notes.Count + 2) + " bytes. */");
+			outfile.WriteLine("");
+			outfile.WriteLine("// DDS phase increments per tick, round(f * 65536 / tick): 1 = A3 .. " + highest + " = " + MelodyExtractor.NoteName(highest) + ", 31 = rest");
+			outfile.WriteLine("const unsigned int note_inc[] = {");
+			StringBuilder line = new StringBuilder("\t0,");
+			for (int n = 1; n <= Rest; n++)
+			{
+				int inc = (n <= highest) ? (int)Math.Round(frequency(n) * 65536 / tickRate) : 0;
+				line.Append(inc).Append(',');
+				if (n % 12 == 0)
+				{
+					outfile.WriteLine(line.ToString());
+					line = new StringBuilder("\t");
+				}
+			}
+			outfile.WriteLine(line.ToString());
+			outfile.WriteLine("\t};");
+			outfile.WriteLine("");
+
+			outfile.WriteLine("// tune[0] ticks per 1/32 note, then dddnnnnn: note_inc[n] for tune_len[d] 1/32 notes; 0 ends");
+			outfile.WriteLine("const unsigned char tune[] = {");
+			outfile.WriteLine("\t" + ticksPer32 + ",");
+			for (int i = 0; i < notes.Count; i++)
+			{
+				int n = notes[i] & 31;
+				outfile.WriteLine("\t0x" + notes[i].ToString("X2") + ",\t// " + Lengths[notes[i] >> 5] + "/32 " + (n == Rest ? "rest" : MelodyExtractor.NoteName(n)));
+			}
+			outfile.WriteLine("\t0");
+			outfile.WriteLine("\t};");
+		}
+	}
+}
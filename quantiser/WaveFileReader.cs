@@ -29,6 +29,16 @@ namespace KadeSoft
 			reader = new BinaryReader(new FileStream(filename, FileMode.Open, FileAccess.Read, FileShare.Read));
 		}
 
+		/*
+		 * WaveFileReader(Stream)
+		 * Reads from an already open stream, which need not be seekable
+		 * (standard input, say) as long as only ReadToData is used on it.
+		 */
+		public WaveFileReader(Stream input)
+		{
+			reader = new BinaryReader(input);
+		}
+
 		/*
 		 * long GetPosition() - 2004 July 28
 		 * Returns the current position of the reader's BaseStream.
@@ -58,7 +68,28 @@ namespace KadeSoft
 		{
 			long NextOffset = (long) reader.ReadUInt32(); //Get next chunk offset
 			//Seek to the next offset from current position
-			reader.BaseStream.Seek(NextOffset,SeekOrigin.Current);
+			Skip(NextOffset);
+		}
+
+		/*
+		 * void Skip(long)
+		 * Moves forward count bytes, by reading them if the stream can't seek.
+		 */
+		public void Skip(long count)
+		{
+			if (reader.BaseStream.CanSeek)
+			{
+				reader.BaseStream.Seek(count, SeekOrigin.Current);
+				return;
+			}
+			byte[] junk = new byte[4096];
+			while (count > 0)
+			{
+				int n = reader.Read(junk, 0, (int)Math.Min(count, (long)junk.Length));
+				if (n <= 0)
+					throw new EndOfStreamException();
+				count -= n;
+			}
 		}
 #endregion
 #region Header Extraction Methods
@@ -79,7 +110,9 @@ namespace KadeSoft
 		}
 
 		//fmtChunk ReadFormatHeader() - 2004 July 28
-		//Again, not much to say.
+		//The bits per sample field is only 16 bits wide; whatever follows it
+		//(cbSize and any extension) is skipped.  A chunk too short to hold
+		//those 16 bytes throws FormatException.
 		public fmtChunk ReadFormatHeader()
 		{
 			format = new fmtChunk();
@@ -91,7 +124,10 @@ namespace KadeSoft
 			format.dwSamplesPerSec = reader.ReadUInt32();
 			format.dwAvgBytesPerSec = reader.ReadUInt32();
 			format.wBlockAlign = reader.ReadUInt16();
-			format.dwBitsPerSample = reader.ReadUInt32();
+			format.dwBitsPerSample = reader.ReadUInt16();
+			if (format.dwChunkSize < 16)
+				throw new FormatException("fmt chunk of " + format.dwChunkSize + " bytes, at least 16 expected");
+			Skip(format.dwChunkSize + (format.dwChunkSize & 1) - 16);
 			return format;
 		} 
 
@@ -116,7 +152,8 @@ namespace KadeSoft
 
 			data.sChunkID = "data";
 			data.dwChunkSize = reader.ReadUInt32();
-			data.lFilePosition = reader.BaseStream.Position;
+			if (reader.BaseStream.CanSeek)
+				data.lFilePosition = reader.BaseStream.Position;
             //if (!fact.Equals(null))
             if (fact != null)
                 data.dwNumSamples = fact.dwNumSamples;
@@ -128,97 +165,168 @@ namespace KadeSoft
 			return data;
 		}
 
+		/*
+		 * WaveFile ReadHeaders(string)
+		 * Walks every chunk of the file and collects the headers, skipping
+		 * over the sample data and anything unsupported.  quantise seeks
+		 * back to the data chunk itself.
+		 */
+		public WaveFile ReadHeaders(string filename)
+		{
+			WaveFile contents = new WaveFile();
+			contents.maindata = ReadMainFileHeader();
+			contents.maindata.FileName = filename;
+			while (GetPosition() + 8 <= (long) contents.maindata.dwFileLength)
+			{
+				string temp = GetChunkName();
+				if (temp=="fmt ")
+					contents.format = ReadFormatHeader();
+				else if (temp=="fact")
+					contents.fact = ReadFactHeader();
+				else if (temp=="data")
+				{
+					contents.data = ReadDataHeader();
+					reader.BaseStream.Seek(contents.data.dwChunkSize, SeekOrigin.Current);
+				}
+				else
+					AdvanceToNext();
+			}
+			return contents;
+		}
+
+		/*
+		 * WaveFile ReadToData(string)
+		 * For streams: reads the headers up to and including the data
+		 * chunk's and stops there, so the samples can be read straight on.
+		 * A data size of 0 or 0xFFFFFFFF (as streaming writers leave it)
+		 * is taken as "to the end of the stream".
+		 */
+		public WaveFile ReadToData(string name)
+		{
+			WaveFile contents = new WaveFile();
+			contents.maindata = ReadMainFileHeader();
+			contents.maindata.FileName = name;
+			if (contents.maindata.sGroupID != "RIFF" || contents.maindata.sRiffType != "WAVE")
+				throw new FormatException(name + " is not a RIFF WAVE stream");
+			while (contents.data == null)
+			{
+				string temp = GetChunkName();
+				if (temp=="fmt ")
+					contents.format = ReadFormatHeader();
+				else if (temp=="data" && contents.format != null)
+				{
+					contents.data = ReadDataHeader();
+					if (contents.data.dwChunkSize == 0)
+						contents.data.dwChunkSize = uint.MaxValue;
+				}
+				else
+					AdvanceToNext();
+			}
+			return contents;
+		}
+
+
+        public bool quantise(StreamWriter outfile, int level)
+        {
+            return quantise(outfile, level, QuantiseMode.Threshold);
+        }
 
         /*
+         * bool quantise(StreamWriter, int, QuantiseMode)
+         * Quantises the data chunk and writes it out as the firmware's
+         * const unsigned char sound[] initializer.
          */
-        public bool quantise(StreamWriter outfile, int level)
+        public bool quantise(StreamWriter outfile, int level, QuantiseMode mode)
         {
-            //Seek to the beginning of the data chunk
-            int channels = 1; // might not be ?
+            QuantiseSettings settings = new QuantiseSettings();
+            settings.Level = level;
+            settings.Mode = mode;
+            return quantise(outfile, settings);
+        }
 
+        public bool quantise(StreamWriter outfile, QuantiseSettings settings)
+        {
+            MemoryStream packed = new MemoryStream();
+            bool result = quantise(packed, settings);
 
-            reader.BaseStream.Seek(data.lFilePosition, SeekOrigin.Begin);
-            byte[] dataset1;
-            int cs = 4444;
+            byte[] bytes = packed.ToArray();
+            Console.WriteLine("sound: " + bytes.Length + " bytes");
+            WriteTable(outfile, "sound", bytes, 0, bytes.Length);
+            return result;
+        }
 
-            int fmtn = 0;
+        public bool quantise(Stream output, int level, QuantiseMode mode)
+        {
+            QuantiseSettings settings = new QuantiseSettings();
+            settings.Level = level;
+            settings.Mode = mode;
+            return quantise(output, settings);
+        }
 
-            Console.WriteLine("const unsigned char sound[] = {");
-            outfile.WriteLine("const unsigned char sound[] = {");
- 
+        /*
+         * bool quantise(Stream, QuantiseSettings)
+         * Runs the data chunk through a Quantiser (see there for the
+         * details) and writes the packed bytes to output.
+         */
+        public bool quantise(Stream output, QuantiseSettings settings)
+        {
             try
             {
-                for (ulong i = (ulong)(data.dwChunkSize / cs); i > 0; i--)
-                {
-                    dataset1 = reader.ReadBytes(cs);
-
-                    int bp = 1;
-                    int bo = 0;
-
-                    for (ulong j = 0; j < (ulong)(cs); j++)
-                    {
-                        //Console.WriteLine("Data[" + i + "/"+ j + "]=" + dataset1[j]);
-
-                        long t = 0;
-
-                        for (ulong s = 0; s < 11; s++)
-                        {
-                            try
-                            {
-                                t += dataset1[j + s];
-                            }
-                            catch (Exception z)
-                            {
-                                Console.WriteLine("Err");
-                            }
-                        }
-
-                        t = t / 11;
-
-                        if (t > level)
-                        {
-                            //Console.WriteLine("1");
-                            bo = bo | bp;
-                        }
-                        else
-                        {
-                            //Console.WriteLine("0");
-                        }
-                        bp = bp << 1;
-                        if (bp == 256)
-                        {
-                            fmtn++;
-                            if (fmtn == 1)
-                            {
-                                Console.Write("\t");
-                                outfile.Write("\t");
-                            }
-                            Console.Write(bo + ",");
-                            outfile.Write(bo + ",");
-                            bp = 1;
-                            bo = 0;
-                            if (fmtn > 10)
-                            {
-                                Console.WriteLine("");
-                                outfile.WriteLine("");
-                                fmtn = 0;
-                            }
-                        }
-                        j += 10;
-                    }
-                }
+                Quantiser q = new Quantiser(format, settings);
 
+                //Seek to the beginning of the data chunk
+                reader.BaseStream.Seek(data.lFilePosition, SeekOrigin.Begin);
+                q.Run(reader.BaseStream, data.dwChunkSize, output, QuantiseBlockSize);
+            }
+            catch (NotSupportedException e)
+            {
+                Console.WriteLine(e.Message);
+                return false;
             }
             catch (Exception e)
             {
                 Console.WriteLine("Error! " + e);
+                return false;
             }
 
-            Console.WriteLine("\n};");
-            outfile.Write("\n};");
-
             return true;
         }
+
+        const int QuantiseBlockSize = 1 << 16;  // bytes per sequential read
+
+        /*
+         * byte[] ReadData()
+         * The whole data chunk, for tools that go over a clip many times.
+         */
+        public byte[] ReadData()
+        {
+            reader.BaseStream.Seek(data.lFilePosition, SeekOrigin.Begin);
+            return reader.ReadBytes((int)Math.Min((long)data.dwChunkSize, reader.BaseStream.Length - data.lFilePosition));
+        }
+
+        /*
+         * void WriteTable(TextWriter, string, byte[], int, int)
+         * Writes bytes as a const unsigned char C initializer, 11 to a line.
+         */
+        public static void WriteTable(TextWriter outfile, string name, byte[] bytes, int offset, int count)
+        {
+            int fmtn = 0;
+
+            outfile.WriteLine("const unsigned char " + name + "[] = {");
+            for (int k = offset; k < offset + count; k++)
+            {
+                fmtn++;
+                if (fmtn == 1)
+                    outfile.Write("\t");
+                outfile.Write(bytes[k] + ",");
+                if (fmtn > 10)
+                {
+                    outfile.WriteLine("");
+                    fmtn = 0;
+                }
+            }
+            outfile.Write("\n};");
+        }
 #endregion
 #region IDisposable Members
 
@@ -0,0 +1,59 @@
+/* Sound bank generated by WaveEdit -bank, do not edit. */
+
+#define SOUND_EYE	0	/* eye.wav, 299 bytes */
+#define SOUND_HELLO	1	/* hello.wav, 181 bytes */
+#define SOUND_COUNT	2
+#define SOUND_LZ	1	/* clips are SoundCompressor streams */
+
+// [offset, length] in bytes of each clip in sound_bank[]
+const unsigned int sound_index[] = {
+	0,299,
+	299,181,
+};
+
+const unsigned char sound_bank[] = {
+	7,32,128,48,198,24,99,140,49,132,196,
+	228,0,56,132,6,115,206,24,227,140,57,
+	231,142,0,204,179,4,115,142,49,231,156,
+	145,142,1,156,51,140,145,135,0,140,143,
+	7,152,51,155,51,103,26,51,230,143,10,
+	156,49,99,38,51,102,204,76,196,204,153,
+	147,1,49,51,138,128,20,198,140,136,25,
+	227,140,49,230,156,51,134,49,103,38,103,
+	206,56,198,156,115,156,142,4,24,99,206,
+	57,231,137,196,4,99,204,57,198,24,169,
+	5,103,140,113,206,25,227,155,3,198,56,
+	231,140,174,2,99,156,51,150,147,2,49,
+	206,24,137,0,115,137,147,137,147,5,204,
+	99,206,152,243,24,189,144,149,134,0,49,
+	166,151,134,0,230,164,0,25,169,213,188,
+	0,231,132,203,240,139,144,164,2,51,198,
+	156,142,1,115,142,240,6,49,206,57,231,
+	140,113,140,132,0,24,146,144,164,156,2,
+	24,227,156,137,144,4,156,115,204,57,199,
+	144,156,3,204,152,49,142,250,0,57,132,
+	174,3,206,57,227,28,134,208,2,156,115,
+	198,146,1,152,115,139,0,230,130,2,206,
+	24,231,149,188,0,25,181,132,7,231,156,
+	51,142,49,198,24,199,151,6,67,24,99,
+	204,24,195,152,206,1,56,198,154,144,149,
+	1,198,136,144,149,4,12,99,140,25,199,
+	188,130,147,188,166,2,113,140,57,166,1,
+	0,0,0,0,128,192,224,224,224,224,0,
+	8,130,1,2,32,233,0,128,130,171,234,
+	0,1,162,46,37,0,10,0,224,1,192,
+	11,224,7,192,23,0,47,208,30,224,125,
+	128,255,128,207,3,63,7,252,28,248,121,
+	240,231,192,143,3,31,47,126,92,248,120,
+	241,227,198,207,11,31,55,170,0,184,138,
+	21,194,207,137,31,19,126,78,252,24,240,
+	115,224,198,128,159,3,55,6,220,24,184,
+	49,138,45,204,141,17,51,102,78,216,152,
+	49,99,66,206,140,25,51,118,100,204,152,
+	17,35,103,198,140,24,57,34,96,196,136,
+	17,33,35,70,140,8,24,48,98,196,128,
+	129,17,3,6,12,144,2,48,96,0,139,
+	7,1,3,32,0,200,0,16,0,139,0,
+	136,165,2,192,0,8,132,2,3,64,0,
+	128,133,130,160,0,4,229,
+};
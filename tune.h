@@ -0,0 +1,21 @@
+/* Tune "cylon" compiled by WaveEdit -rtttl from cylon.rtttl, do not edit. */
+/* 1953.125 Hz tick, 6 notes, 8 bytes. */
+
+// DDS phase increments per tick, round(f * 65536 / tick): 1 = A3 .. 26 = A#5, 31 = rest
+const unsigned int note_inc[] = {
+	0,7382,7821,8286,8779,9301,9854,10440,11060,11718,12415,13153,13935,
+	14764,15642,16572,17557,18601,19708,20879,22121,23436,24830,26306,27871,
+	29528,31284,0,0,0,0,0,
+	};
+
+// tune[0] ticks per 1/32 note, then dddnnnnn: note_inc[n] for tune_len[d] 1/32 notes; 0 ends
+const unsigned char tune[] = {
+	131,
+	0x4F,	// 4/32 B4
+	0x5F,	// 4/32 rest
+	0x68,	// 8/32 E4
+	0x5F,	// 4/32 rest
+	0xE8,	// 12/32 E4
+	0x6F,	// 8/32 B4
+	0
+	};